@@ -0,0 +1,39 @@
+#include "contentHash.h"
+#include <bit>
+
+static constexpr uint64_t PRIME1 = 0x9E3779B185EBCA87ull;
+static constexpr uint64_t PRIME2 = 0xC2B2AE3D27D4EB4Full;
+static constexpr uint64_t PRIME3 = 0x165667B19E3779F9ull;
+static constexpr uint64_t PRIME4 = 0x85EBCA77C2B2AE63ull;
+static constexpr uint64_t PRIME5 = 0x27D4EB2F165667C5ull;
+
+ContentHasher::ContentHasher(int size)
+    : m_state(PRIME5 + (uint64_t)size * PRIME1) {
+}
+
+void ContentHasher::addRow(const uint32_t* pixels, int count) {
+    uint64_t h = m_state;
+
+    // Two pixels per 64-bit lane, then a lone trailing pixel
+    int i = 0;
+    for (; i + 1 < count; i += 2) {
+        uint64_t k = (pixels[i] | ((uint64_t)pixels[i + 1] << 32)) * PRIME2;
+        k = std::rotl(k, 31) * PRIME1;
+        h = std::rotl(h ^ k, 27) * PRIME1 + PRIME4;
+    }
+    if (i < count) {
+        h = std::rotl(h ^ (pixels[i] * PRIME1), 23) * PRIME2 + PRIME3;
+    }
+
+    m_state = h;
+}
+
+uint64_t ContentHasher::finish() const {
+    uint64_t h = m_state;
+    h ^= h >> 33;
+    h *= PRIME2;
+    h ^= h >> 29;
+    h *= PRIME3;
+    h ^= h >> 32;
+    return h;
+}
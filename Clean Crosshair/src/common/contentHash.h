@@ -0,0 +1,20 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+
+// 64-bit hash of a square grid's size and packed pixels (see pixel.h), fed one
+// full row at a time. Pixel-identical grids hash equal whatever their storage
+// format. Uses the xxHash64 mixing steps; not meant to resist attacks.
+class ContentHasher {
+public:
+    explicit ContentHasher(int size);
+
+    // Add the next row of pixels
+    void addRow(const uint32_t* pixels, int count);
+
+    uint64_t finish() const;
+
+private:
+    uint64_t m_state;
+};
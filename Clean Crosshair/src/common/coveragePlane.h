@@ -0,0 +1,92 @@
+#pragma once
+
+#include <array>
+#include <vector>
+#include <variant>
+#include <cstdint>
+#include <cstddef>
+
+// Coverage bits of a grid whose size is known at compile time. Loops written
+// against size() and wordsPerRow() get constant trip counts, so the compiler can
+// unroll and vectorize them for the common preset sizes.
+template <int N>
+struct FixedMask {
+    static constexpr int size() { return N; }
+    static constexpr int wordsPerRow() { return (N + 63) / 64; }
+
+    uint64_t* row(int y) { return &words[y * wordsPerRow()]; }
+    const uint64_t* row(int y) const { return &words[y * wordsPerRow()]; }
+
+    std::array<uint64_t, wordsPerRow() * N> words{};
+};
+
+// Coverage bits of a grid of any other size
+struct DynamicMask {
+    explicit DynamicMask(int size)
+        : n(size), stride((size + 63) / 64), words((size_t)stride * size, 0) {}
+
+    int size() const { return n; }
+    int wordsPerRow() const { return stride; }
+
+    uint64_t* row(int y) { return &words[y * stride]; }
+    const uint64_t* row(int y) const { return &words[y * stride]; }
+
+    int n;
+    int stride;
+    std::vector<uint64_t> words;
+};
+
+// One bit per pixel (LSB first, rows padded to whole 64-bit words), stored in a
+// std::array for 32, 64 and 128 pixel grids and in a vector otherwise.
+// visit() hands the concrete mask to a generic lambda for bulk loops; the
+// per-pixel accessors go through a cached pointer instead.
+class CoveragePlane {
+public:
+    explicit CoveragePlane(int size = 0) { reset(size); }
+
+    CoveragePlane(CoveragePlane&& other) noexcept : m_mask(std::move(other.m_mask)) { bind(); }
+    CoveragePlane& operator=(CoveragePlane&& other) noexcept {
+        m_mask = std::move(other.m_mask);
+        bind();
+        return *this;
+    }
+
+    // Clear every bit and switch to the representation for the given size
+    void reset(int size) {
+        switch (size) {
+        case 32: m_mask.emplace<FixedMask<32>>(); break;
+        case 64: m_mask.emplace<FixedMask<64>>(); break;
+        case 128: m_mask.emplace<FixedMask<128>>(); break;
+        default: m_mask.emplace<DynamicMask>(size); break;
+        }
+        bind();
+    }
+
+    // Whether the size has a compile-time specialization
+    bool isFixed() const { return !std::holds_alternative<DynamicMask>(m_mask); }
+
+    int wordsPerRow() const { return m_wordsPerRow; }
+    size_t getMemoryUsage() const { return m_wordCount * sizeof(uint64_t); }
+
+    uint64_t* row(int y) { return m_words + y * m_wordsPerRow; }
+    const uint64_t* row(int y) const { return m_words + y * m_wordsPerRow; }
+
+    template <typename Fn>
+    decltype(auto) visit(Fn&& fn) { return std::visit(fn, m_mask); }
+    template <typename Fn>
+    decltype(auto) visit(Fn&& fn) const { return std::visit(fn, m_mask); }
+
+private:
+    std::variant<FixedMask<32>, FixedMask<64>, FixedMask<128>, DynamicMask> m_mask;
+    uint64_t* m_words = nullptr;
+    int m_wordsPerRow = 0;
+    size_t m_wordCount = 0;
+
+    void bind() {
+        std::visit([this](auto& mask) {
+            m_words = mask.words.data();
+            m_wordsPerRow = mask.wordsPerRow();
+            m_wordCount = mask.words.size();
+        }, m_mask);
+    }
+};
\ No newline at end of file
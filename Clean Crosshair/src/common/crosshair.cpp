@@ -1,26 +1,61 @@
 #include "crosshair.h"
-#include <sstream>
-#include <iomanip>
+#include "presetFormat.h"
+#include "presetSink.h"
+#include "contentHash.h"
+#include "threadPool.h"
 #include <algorithm>
+#include <charconv>
+#include <cctype>
+#include <bit>
 
 // Include ImGui headers here
 #include "../ext/ImGui/imgui.h"
 #include "../ext/ImGui/imgui_impl_win32.h"
 #include "../ext/ImGui/imgui_impl_dx11.h"
 
-uint32_t Color::toImU32() const {
-    return IM_COL32(r, g, b, a);
+// Packed pixels go to ImGui and the texture as they are
+static_assert(Color(1, 2, 3, 4).toImU32() == IM_COL32(1, 2, 3, 4), "Packed pixels must match the ImU32 layout");
+
+void PixelRect::include(int x, int y) {
+    include(PixelRect(x, y, x + 1, y + 1));
 }
 
-Crosshair::Crosshair() : m_size(DEFAULT_SIZE) {
+void PixelRect::include(const PixelRect& other) {
+    if (other.isEmpty()) return;
+
+    if (isEmpty()) {
+        *this = other;
+        return;
+    }
+
+    minX = std::min(minX, other.minX);
+    minY = std::min(minY, other.minY);
+    maxX = std::max(maxX, other.maxX);
+    maxY = std::max(maxY, other.maxY);
+}
+
+Crosshair::Crosshair()
+    : m_size(DEFAULT_SIZE)
+    , m_opaqueCount(0)
+    , m_opaqueBoundsStale(false)
+    , m_generation(1)
+    , m_batchDepth(0)
+    , m_dirtyHistoryCount(0)
+    , m_meshGeneration(0)
+    , m_textureGeneration(0)
+    , m_contentHash(0)
+    , m_contentHashGeneration(0) {
     // Initialize the grid with transparent pixels
-    m_pixels.resize(m_size * m_size, Color(0, 0, 0, 0));
+    m_pixels.reset(m_size);
+    m_dirtyHistory.fill({ 0, PixelRect() });
 }
 
 Crosshair::~Crosshair() {
 }
 
 void Crosshair::initDefault() {
+    beginBatch();
+
     // Clear existing pixels
     clear();
 
@@ -30,173 +65,732 @@ void Crosshair::initDefault() {
     int center = m_size / 2;
     int thickness = 2;
     int length = 10;
+    int thicknessMin = center - thickness / 2;
+    int thicknessMax = center + thickness / 2 + (thickness % 2);
 
     // Horizontal line
-    for (int x = center - length; x <= center + length; x++) {
-        for (int y = center - thickness / 2; y < center + thickness / 2 + (thickness % 2); y++) {
-            if (x >= 0 && x < m_size && y >= 0 && y < m_size) {
-                setPixel(x, y, white);
-            }
-        }
-    }
+    fillRect(PixelRect(center - length, thicknessMin, center + length + 1, thicknessMax), white);
 
     // Vertical line
-    for (int y = center - length; y <= center + length; y++) {
-        for (int x = center - thickness / 2; x < center + thickness / 2 + (thickness % 2); x++) {
-            if (x >= 0 && x < m_size && y >= 0 && y < m_size) {
-                setPixel(x, y, white);
-            }
-        }
-    }
+    fillRect(PixelRect(thicknessMin, center - length, thicknessMax, center + length + 1), white);
 
     // Add a small gap in the center
     int gap = 2;
-    for (int x = center - gap; x <= center + gap; x++) {
-        for (int y = center - gap; y <= center + gap; y++) {
-            if (x >= 0 && x < m_size && y >= 0 && y < m_size) {
-                setPixel(x, y, Color(0, 0, 0, 0)); // Transparent
-            }
-        }
-    }
+    fillRect(PixelRect(center - gap, center - gap, center + gap + 1, center + gap + 1), Color(0, 0, 0, 0));
+
+    commitBatch();
 }
 
 void Crosshair::setPixel(int x, int y, const Color& color) {
     if (x >= 0 && x < m_size && y >= 0 && y < m_size) {
-        m_pixels[y * m_size + x] = color;
+        setPixelUnchecked(x, y, color.toImU32());
+    }
+}
+
+void Crosshair::setPixelUnchecked(int x, int y, uint32_t color) {
+    // Fully transparent pixels are all stored as 0
+    uint32_t value = packedAlpha(color) != 0 ? color : 0;
+    uint32_t pixel = m_pixels.get(x, y);
+    if (pixel == value) return;
+
+    m_pixels.set(x, y, value);
+
+    if (pixel == 0) {
+        m_opaqueCount++;
+        m_opaqueBounds.include(x, y);
     }
+    else if (value == 0) {
+        m_opaqueCount--;
+        if (x == m_opaqueBounds.minX || x == m_opaqueBounds.maxX - 1 ||
+            y == m_opaqueBounds.minY || y == m_opaqueBounds.maxY - 1) {
+            m_opaqueBoundsStale = true;
+        }
+    }
+
+    markDirty(PixelRect(x, y, x + 1, y + 1));
 }
 
 Color Crosshair::getPixel(int x, int y) const {
     if (x >= 0 && x < m_size && y >= 0 && y < m_size) {
-        return m_pixels[y * m_size + x];
+        return Color::fromImU32(m_pixels.get(x, y));
     }
     return Color(0, 0, 0, 0); // Return transparent if out of bounds
 }
 
 void Crosshair::clear() {
-    std::fill(m_pixels.begin(), m_pixels.end(), Color(0, 0, 0, 0));
+    // Only the opaque footprint can hold anything to clear
+    PixelRect bounds = getOpaqueBounds();
+    if (bounds.isEmpty()) return;
+
+    // Emptying the storage also returns it to the compact mask format
+    m_pixels.clearRect(bounds);
+
+    m_opaqueCount = 0;
+    m_opaqueBounds = PixelRect();
+    m_opaqueBoundsStale = false;
+
+    markDirty(bounds);
+}
+
+void Crosshair::fillRect(const PixelRect& rect, const Color& color) {
+    PixelRect clipped(std::max(rect.minX, 0), std::max(rect.minY, 0),
+        std::min(rect.maxX, m_size), std::min(rect.maxY, m_size));
+    if (clipped.isEmpty()) return;
+
+    if (!m_pixels.fillRect(clipped, color.toImU32())) return;
+
+    m_opaqueCount = m_pixels.getCoveredCount();
+    if (color.a != 0) {
+        m_opaqueBounds.include(clipped);
+    }
+    else if (m_opaqueCount == 0) {
+        m_opaqueBounds = PixelRect();
+        m_opaqueBoundsStale = false;
+    }
+    else if (clipped.minX <= m_opaqueBounds.minX || clipped.maxX >= m_opaqueBounds.maxX ||
+        clipped.minY <= m_opaqueBounds.minY || clipped.maxY >= m_opaqueBounds.maxY) {
+        m_opaqueBoundsStale = true;
+    }
+
+    markDirty(clipped);
+}
+
+int Crosshair::replaceColor(const Color& from, const Color& to) {
+    PixelRect bounds = getOpaqueBounds();
+
+    int replaced = m_pixels.replaceColor(from.toImU32(), to.toImU32());
+    if (replaced == 0) return 0;
+
+    // Replacing with a transparent color erases pixels
+    if (m_pixels.getCoveredCount() != m_opaqueCount) {
+        m_opaqueCount = m_pixels.getCoveredCount();
+        m_opaqueBoundsStale = true;
+    }
+
+    markDirty(bounds);
+    return replaced;
+}
+
+void Crosshair::multiplyAlpha(uint8_t factor) {
+    PixelRect bounds = getOpaqueBounds();
+    if (bounds.isEmpty() || factor == 255) return;
+
+    m_pixels.multiplyAlpha(factor);
+
+    // Pixels that faded out completely are gone
+    if (m_pixels.getCoveredCount() != m_opaqueCount) {
+        m_opaqueCount = m_pixels.getCoveredCount();
+        m_opaqueBoundsStale = true;
+    }
+
+    markDirty(bounds);
 }
 
 void Crosshair::resize(int newSize) {
     if (newSize <= 0) return;
 
-    std::vector<Color> newPixels(newSize * newSize, Color(0, 0, 0, 0));
+    // The storage copies only covered pixels that still fit
+    PixelRect bounds = getOpaqueBounds();
+    bounds.maxX = std::min(bounds.maxX, newSize);
+    bounds.maxY = std::min(bounds.maxY, newSize);
+
+    m_pixels.resize(newSize);
+    m_size = newSize;
+
+    // Shrinking may have cut pixels off, so rescan what was kept
+    recomputeCoverage(bounds);
+
+    markDirty(PixelRect(0, 0, m_size, m_size));
+}
 
-    // Copy existing pixels to new grid
-    int minSize = std::min(m_size, newSize);
-    for (int y = 0; y < minSize; y++) {
-        for (int x = 0; x < minSize; x++) {
-            newPixels[y * newSize + x] = m_pixels[y * m_size + x];
+PixelRect Crosshair::getOpaqueBounds() const {
+    if (m_opaqueBoundsStale) {
+        // Shrink within the old bounds; nothing outside them can be opaque
+        PixelRect old = m_opaqueBounds;
+        PixelRect bounds;
+        if (m_opaqueCount > 0) {
+            for (int y = old.minY; y < old.maxY; y++) {
+                m_pixels.forEachSpan(y, [&](int startX, int endX) {
+                    bounds.include(PixelRect(startX, y, endX, y + 1));
+                });
+            }
         }
+        m_opaqueBounds = bounds;
+        m_opaqueBoundsStale = false;
     }
 
-    m_pixels = std::move(newPixels);
-    m_size = newSize;
+    return m_opaqueBounds;
+}
+
+void Crosshair::recomputeCoverage(const PixelRect& region) {
+    m_opaqueCount = 0;
+    m_opaqueBounds = PixelRect();
+    m_opaqueBoundsStale = false;
+
+    if (region.isEmpty()) return;
+
+    for (int y = region.minY; y < region.maxY; y++) {
+        m_pixels.forEachSpan(y, [&](int startX, int endX) {
+            startX = std::max(startX, region.minX);
+            endX = std::min(endX, region.maxX);
+            if (startX < endX) {
+                m_opaqueCount += endX - startX;
+                m_opaqueBounds.include(PixelRect(startX, y, endX, y + 1));
+            }
+        });
+    }
+}
+
+PixelRect Crosshair::getDirtyRect(uint64_t sinceGeneration) const {
+    PixelRect full(0, 0, m_size, m_size);
+
+    if (sinceGeneration >= m_generation) {
+        return PixelRect();
+    }
+
+    // Older than the recorded history (or never synced): assume everything changed
+    if (sinceGeneration == 0 || sinceGeneration < m_generation - m_dirtyHistoryCount) {
+        return full;
+    }
+
+    PixelRect dirty;
+    for (const DirtyEntry& entry : m_dirtyHistory) {
+        if (entry.generation > sinceGeneration) {
+            dirty.include(entry.rect);
+        }
+    }
+
+    // Entries recorded before a resize may extend past the current grid
+    dirty.maxX = std::min(dirty.maxX, m_size);
+    dirty.maxY = std::min(dirty.maxY, m_size);
+    return dirty;
+}
+
+void Crosshair::beginBatch() {
+    m_batchDepth++;
+}
+
+void Crosshair::commitBatch() {
+    if (m_batchDepth == 0) return;
+
+    if (--m_batchDepth == 0) {
+        publishDirty();
+    }
+}
+
+void Crosshair::markDirty(const PixelRect& rect) {
+    m_pendingDirty.include(rect);
+
+    if (m_batchDepth == 0) {
+        publishDirty();
+    }
+}
+
+void Crosshair::publishDirty() {
+    if (m_pendingDirty.isEmpty()) return;
+
+    m_generation++;
+
+    // Ring buffer of the most recent generations
+    DirtyEntry& entry = m_dirtyHistory[m_generation % DIRTY_HISTORY_SIZE];
+    entry.generation = m_generation;
+    entry.rect = m_pendingDirty;
+    m_dirtyHistoryCount = std::min(m_dirtyHistoryCount + 1, DIRTY_HISTORY_SIZE);
+
+    m_pendingDirty = PixelRect();
 }
 
 void Crosshair::draw(float posX, float posY, float scale) {
     // Get ImGui draw list for rendering
-    ImDrawList* drawList = ImGui::GetBackgroundDrawList();
-
-    // Calculate pixel size based on scale
-    float pixelSize = scale;
+    draw(ImGui::GetBackgroundDrawList(), posX, posY, scale);
+}
 
+void Crosshair::draw(ImDrawList* drawList, float posX, float posY, float scale) {
     // Calculate top-left position to center the crosshair
-    float startX = posX - (m_size * pixelSize) / 2.0f;
-    float startY = posY - (m_size * pixelSize) / 2.0f;
+    float startX = posX - (m_size * scale) / 2.0f;
+    float startY = posY - (m_size * scale) / 2.0f;
+
+    if (m_texture) {
+        // Upload only what changed since the last draw
+        if (m_textureGeneration != m_generation || m_texture->getWidth() != m_size) {
+            PixelRect dirty = getDirtyRect(m_textureGeneration);
+            if (m_texture->getWidth() != m_size || m_texture->getHeight() != m_size) {
+                dirty = PixelRect(0, 0, m_size, m_size);
+            }
 
-    // Draw each pixel
-    for (int y = 0; y < m_size; y++) {
-        for (int x = 0; x < m_size; x++) {
-            Color color = getPixel(x, y);
-
-            // Skip fully transparent pixels
-            if (color.a == 0) continue;
-
-            // Calculate pixel position
-            float pixelX = startX + x * pixelSize;
-            float pixelY = startY + y * pixelSize;
-
-            // Draw the pixel as a filled rectangle
-            drawList->AddRectFilled(
-                ImVec2(pixelX, pixelY),
-                ImVec2(pixelX + pixelSize, pixelY + pixelSize),
-                color.toImU32()
-            );
+            // Gather the dirty rectangle; packed pixels are already RGBA8
+            m_uploadBuffer.resize(std::max(dirty.width() * dirty.height(), 0));
+            for (int y = dirty.minY; y < dirty.maxY; y++) {
+                m_pixels.readRow(y, dirty.minX, dirty.width(), &m_uploadBuffer[(y - dirty.minY) * dirty.width()]);
+            }
+
+            const uint32_t* pixels = m_uploadBuffer.data();
+            if (m_texture->upload(m_size, m_size, dirty.minX, dirty.minY, dirty.width(), dirty.height(), pixels, dirty.width())) {
+                m_textureGeneration = m_generation;
+            }
+        }
+
+        m_texture->draw(drawList, startX, startY, startX + m_size * scale, startY + m_size * scale);
+        return;
+    }
+
+    if (m_meshGeneration != m_generation) {
+        rebuildMesh();
+    }
+
+    if (m_meshVertices.empty()) return;
+
+    ImVec2 uv = ImGui::GetFontTexUvWhitePixel();
+
+    // With 16-bit indices a single reservation must stay below 64k vertices,
+    // so large meshes are replayed in chunks of whole quads
+    int quadCount = (int)m_meshVertices.size() / 4;
+    int maxQuads = sizeof(ImDrawIdx) == 2 ? 0xFFFF / 4 : quadCount;
+
+    for (int firstQuad = 0; firstQuad < quadCount; firstQuad += maxQuads) {
+        int quads = std::min(maxQuads, quadCount - firstQuad);
+        int vtxCount = quads * 4;
+        int idxCount = quads * 6;
+
+        drawList->PrimReserve(idxCount, vtxCount);
+
+        // Copy vertices, transformed to screen space
+        const MeshVertex* srcVtx = &m_meshVertices[firstQuad * 4];
+        ImDrawVert* dstVtx = drawList->_VtxWritePtr;
+        for (int i = 0; i < vtxCount; i++) {
+            dstVtx[i].pos = ImVec2(startX + srcVtx[i].x * scale, startY + srcVtx[i].y * scale);
+            dstVtx[i].uv = uv;
+            dstVtx[i].col = srcVtx[i].col;
         }
+
+        // Copy indices, rebased onto the draw list's current vertex
+        const uint32_t* srcIdx = &m_meshIndices[firstQuad * 6];
+        ImDrawIdx* dstIdx = drawList->_IdxWritePtr;
+        uint32_t base = drawList->_VtxCurrentIdx - firstQuad * 4;
+        for (int i = 0; i < idxCount; i++) {
+            dstIdx[i] = (ImDrawIdx)(base + srcIdx[i]);
+        }
+
+        drawList->_VtxWritePtr += vtxCount;
+        drawList->_IdxWritePtr += idxCount;
+        drawList->_VtxCurrentIdx += vtxCount;
     }
 }
 
-std::string Crosshair::serialize() const {
-    std::stringstream ss;
+void Crosshair::setTexture(std::shared_ptr<PixelTexture> texture) {
+    m_texture = texture;
+    m_textureGeneration = 0;
+}
 
-    // Format: size,r,g,b,a,r,g,b,a,...
-    ss << m_size;
+int Crosshair::getMeshVertexCount() {
+    if (m_meshGeneration != m_generation) {
+        rebuildMesh();
+    }
+    return (int)m_meshVertices.size();
+}
+
+void Crosshair::rebuildMesh() {
+    m_meshVertices.clear();
+    m_meshIndices.clear();
+
+    // Nothing outside the opaque bounds produces geometry; sparse storage
+    // further limits the merge to its populated tiles
+    PixelRect bounds = getOpaqueBounds();
+    m_pixels.forEachRegion([&](const PixelRect& region) {
+        PixelRect clipped(std::max(region.minX, bounds.minX), std::max(region.minY, bounds.minY),
+            std::min(region.maxX, bounds.maxX), std::min(region.maxY, bounds.maxY));
+        if (!clipped.isEmpty()) {
+            mergeRegion(clipped);
+        }
+    });
+
+    m_meshGeneration = m_generation;
+}
+
+void Crosshair::mergeRegion(const PixelRect& region) {
+    int regionWidth = region.width();
+    int regionHeight = region.height();
+
+    // Row views of the region; contiguous rows are read in place, others are
+    // decoded into the scratch buffer
+    m_mergePixels.resize(regionWidth * regionHeight);
+    m_mergeRows.resize(regionHeight);
+    for (int ry = 0; ry < regionHeight; ry++) {
+        m_mergeRows[ry] = m_pixels.getRow(region.minY + ry, region.minX, regionWidth, &m_mergePixels[ry * regionWidth]);
+    }
+
+    // Greedy merge: grow each unvisited pixel right along its run of the same
+    // color, then down while the whole run below matches
+    m_mergeCovered.assign(regionWidth * regionHeight, 0);
+    std::vector<uint8_t>& covered = m_mergeCovered;
+
+    for (int ry = 0; ry < regionHeight; ry++) {
+        std::span<const uint32_t> row = m_mergeRows[ry];
+        const uint8_t* rowCovered = &covered[ry * regionWidth];
+
+        for (int rx = 0; rx < regionWidth; rx++) {
+            uint32_t color = row[rx];
+
+            // Skip fully transparent and already merged pixels
+            if (color == 0 || rowCovered[rx]) continue;
+
+            int width = 1;
+            while (rx + width < regionWidth && !rowCovered[rx + width] && row[rx + width] == color) {
+                width++;
+            }
+
+            int height = 1;
+            while (ry + height < regionHeight) {
+                std::span<const uint32_t> below = m_mergeRows[ry + height].subspan(rx, width);
+                const uint8_t* belowCovered = &covered[(ry + height) * regionWidth + rx];
+                bool rowMatches = true;
+                for (int i = 0; i < width; i++) {
+                    if (belowCovered[i] || below[i] != color) {
+                        rowMatches = false;
+                        break;
+                    }
+                }
+                if (!rowMatches) break;
+                height++;
+            }
+
+            for (int i = 0; i < height; i++) {
+                std::fill_n(covered.begin() + (ry + i) * regionWidth + rx, width, (uint8_t)1);
+            }
+
+            // Emit the rectangle as a quad (same winding as ImDrawList::PrimRect);
+            // packed pixels are already ImU32 colors
+            uint32_t first = (uint32_t)m_meshVertices.size();
+            float x0 = (float)(region.minX + rx), y0 = (float)(region.minY + ry);
+            float x1 = x0 + width, y1 = y0 + height;
+
+            m_meshVertices.push_back({ x0, y0, color });
+            m_meshVertices.push_back({ x1, y0, color });
+            m_meshVertices.push_back({ x1, y1, color });
+            m_meshVertices.push_back({ x0, y1, color });
+
+            m_meshIndices.push_back(first);
+            m_meshIndices.push_back(first + 1);
+            m_meshIndices.push_back(first + 2);
+            m_meshIndices.push_back(first);
+            m_meshIndices.push_back(first + 2);
+            m_meshIndices.push_back(first + 3);
+        }
+    }
+}
+
+std::vector<uint32_t> Crosshair::getPixels() const {
+    std::vector<uint32_t> pixels((size_t)m_size * m_size);
+    for (int y = 0; y < m_size; y++) {
+        m_pixels.readRow(y, 0, m_size, &pixels[(size_t)y * m_size]);
+    }
+    return pixels;
+}
+
+void Crosshair::assignPixels(int size, std::span<const uint32_t> pixels) {
+    m_pixels.assign(size, pixels);
+    m_size = size;
+    recomputeCoverage(PixelRect(0, 0, m_size, m_size));
+    markDirty(PixelRect(0, 0, m_size, m_size));
+}
+
+void Crosshair::writeRect(const PixelRect& rect, const uint32_t* pixels, int stride) {
+    if (rect.isEmpty()) return;
+
+    // Pixels erased on the edge of the bounds may shrink them
+    if (rect.minX <= m_opaqueBounds.minX || rect.maxX >= m_opaqueBounds.maxX ||
+        rect.minY <= m_opaqueBounds.minY || rect.maxY >= m_opaqueBounds.maxY) {
+        m_opaqueBoundsStale = true;
+    }
+
+    for (int y = rect.minY; y < rect.maxY; y++) {
+        m_pixels.writeRow(y, rect.minX, rect.width(), pixels + (size_t)y * stride + rect.minX);
+        m_pixels.forEachSpan(y, [&](int startX, int endX) {
+            startX = std::max(startX, rect.minX);
+            endX = std::min(endX, rect.maxX);
+            if (startX < endX) {
+                m_opaqueBounds.include(PixelRect(startX, y, endX, y + 1));
+            }
+        });
+    }
+    m_opaqueCount = m_pixels.getCoveredCount();
+
+    markDirty(rect);
+}
+
+void Crosshair::swapPixels(Crosshair& other) {
+    // A cached content hash moves with the pixels it was computed for
+    bool hashValid = m_contentHashGeneration == m_generation;
+    bool otherHashValid = other.m_contentHashGeneration == other.m_generation;
+
+    std::swap(m_pixels, other.m_pixels);
+    std::swap(m_size, other.m_size);
+    std::swap(m_opaqueCount, other.m_opaqueCount);
+    std::swap(m_opaqueBounds, other.m_opaqueBounds);
+    std::swap(m_opaqueBoundsStale, other.m_opaqueBoundsStale);
+    std::swap(m_contentHash, other.m_contentHash);
+
+    markDirty(PixelRect(0, 0, m_size, m_size));
+    other.markDirty(PixelRect(0, 0, other.m_size, other.m_size));
 
-    for (const auto& pixel : m_pixels) {
-        ss << "," << (int)pixel.r
-            << "," << (int)pixel.g
-            << "," << (int)pixel.b
-            << "," << (int)pixel.a;
+    m_contentHashGeneration = otherHashValid ? m_generation : 0;
+    other.m_contentHashGeneration = hashValid ? other.m_generation : 0;
+}
+
+uint64_t Crosshair::getContentHash() const {
+    // Writes inside a batch do not bump the generation until it commits
+    if (m_contentHashGeneration == m_generation && m_batchDepth == 0) {
+        return m_contentHash;
     }
 
-    return ss.str();
+    ContentHasher hasher(m_size);
+    std::vector<uint32_t> scratch(m_size);
+    for (int y = 0; y < m_size; y++) {
+        std::span<const uint32_t> row = m_pixels.getRow(y, 0, m_size, scratch.data());
+        hasher.addRow(row.data(), m_size);
+    }
+
+    m_contentHash = hasher.finish();
+    m_contentHashGeneration = m_batchDepth == 0 ? m_generation : 0;
+    return m_contentHash;
 }
 
-bool Crosshair::deserialize(const std::string& data) {
-    std::stringstream ss(data);
-    std::string token;
+// Text of one CSV channel value including its leading comma, ",0" to ",255"
+struct ChannelText {
+    char text[4];
+    uint8_t length;
+};
+
+static constexpr std::array<ChannelText, 256> makeChannelTextTable() {
+    std::array<ChannelText, 256> table{};
+    for (int value = 0; value < 256; value++) {
+        ChannelText& entry = table[value];
+        entry.text[entry.length++] = ',';
+        if (value >= 100) entry.text[entry.length++] = (char)('0' + value / 100);
+        if (value >= 10) entry.text[entry.length++] = (char)('0' + value / 10 % 10);
+        entry.text[entry.length++] = (char)('0' + value % 10);
+    }
+    return table;
+}
+
+static constexpr std::array<ChannelText, 256> s_channelText = makeChannelTextTable();
+
+static void writeChannel(PresetSink& sink, uint32_t value) {
+    const ChannelText& entry = s_channelText[value];
+    sink.write(entry.text, entry.length);
+}
+
+std::string Crosshair::serialize() const {
+    std::string data;
+    StringSink sink(data);
+    serialize(sink);
+    sink.finish();
+    return data;
+}
 
-    // Get size
-    if (!std::getline(ss, token, ',')) return false;
+void Crosshair::serialize(PresetSink& sink) const {
+    // Format: size,r,g,b,a,r,g,b,a,...
+    char sizeText[16];
+    auto [sizeEnd, error] = std::to_chars(sizeText, sizeText + sizeof(sizeText), m_size);
+    sink.write(sizeText, sizeEnd - sizeText);
+
+    // Everything outside the opaque bounds is transparent, so it is written
+    // as a precomputed run instead of being formatted pixel by pixel
+    PixelRect bounds = getOpaqueBounds();
+    static constexpr std::string_view transparent = ",0,0,0,0";
+    std::string emptyRow;
+    emptyRow.reserve(transparent.size() * m_size);
+    for (int x = 0; x < m_size; x++) {
+        emptyRow += transparent;
+    }
+
+    std::vector<uint32_t> scratch(std::max(bounds.width(), 0));
+
+    for (int y = 0; y < m_size; y++) {
+        if (y < bounds.minY || y >= bounds.maxY) {
+            sink.write(emptyRow.data(), emptyRow.size());
+            continue;
+        }
+
+        // Only the covered runs are decoded; the gaps between them are empty
+        int x = 0;
+        m_pixels.forEachSpan(y, [&](int startX, int endX) {
+            sink.write(emptyRow.data(), transparent.size() * (startX - x));
+
+            for (uint32_t pixel : m_pixels.getRow(y, startX, endX - startX, scratch.data())) {
+                writeChannel(sink, pixel & 0xFF);
+                writeChannel(sink, (pixel >> 8) & 0xFF);
+                writeChannel(sink, (pixel >> 16) & 0xFF);
+                writeChannel(sink, pixel >> 24);
+            }
+            x = endX;
+        });
+
+        sink.write(emptyRow.data(), transparent.size() * (m_size - x));
+    }
+}
 
-    try {
-        int newSize = std::stoi(token);
+// Parse comma-prefixed channel values (",r,g,b,a,...") filling [p, end)
+// exactly, one byte per value
+static bool parseChannels(const char* p, const char* end, uint8_t* out) {
+    while (p < end) {
+        if (*p != ',') return false;
 
-        if (newSize <= 0) return false;
+        unsigned int value;
+        auto [next, error] = std::from_chars(p + 1, end, value);
+        if (error != std::errc() || value > 255) return false;
 
-        std::vector<Color> newPixels;
-        newPixels.reserve(newSize * newSize);
+        *out++ = (uint8_t)value;
+        p = next;
+    }
+    return true;
+}
 
-        // Read all pixels
-        int value;
-        for (int i = 0; i < newSize * newSize; i++) {
-            Color color;
+// Parse text written by serialize: one comma before every value and nothing
+// else. Grids of PARALLEL_PARSE_MIN_VALUES channels or more are split at
+// commas into chunks parsed on the shared thread pool.
+static bool parseExact(std::string_view data, int& size, std::vector<uint32_t>& pixels) {
+    const char* end = data.data() + data.size();
+    int newSize = 0;
+    auto [body, error] = std::from_chars(data.data(), end, newSize);
+    if (error != std::errc() || newSize <= 0 || newSize > PresetFormat::MAX_SIZE) return false;
+
+    // Every value is preceded by exactly one comma, so chunks split at commas
+    // know where their values go from the comma counts of the chunks before them
+    ThreadPool& pool = ThreadPool::getShared();
+    size_t valueCount = (size_t)newSize * newSize * 4;
+    int chunkCount = 1;
+    if (valueCount >= Crosshair::PARALLEL_PARSE_MIN_VALUES && std::endian::native == std::endian::little) {
+        chunkCount = (int)std::clamp<size_t>(pool.getThreadCount(), 1,
+            (size_t)(end - body) / Crosshair::PARALLEL_PARSE_MIN_CHUNK + 1);
+    }
 
-            // Read r
-            if (!std::getline(ss, token, ',')) return false;
-            value = std::stoi(token);
-            if (value < 0 || value > 255) return false;
-            color.r = static_cast<uint8_t>(value);
+    std::vector<const char*> bounds(chunkCount + 1);
+    bounds[0] = body;
+    bounds[chunkCount] = end;
+    for (int i = 1; i < chunkCount; i++) {
+        const char* nominal = body + (end - body) * i / chunkCount;
+        bounds[i] = std::find(std::max(nominal, bounds[i - 1]), end, ',');
+    }
 
-            // Read g
-            if (!std::getline(ss, token, ',')) return false;
-            value = std::stoi(token);
-            if (value < 0 || value > 255) return false;
-            color.g = static_cast<uint8_t>(value);
+    std::vector<size_t> firstValue(chunkCount + 1, 0);
+    std::vector<uint8_t> chunkOk(chunkCount, 0);
 
-            // Read b
-            if (!std::getline(ss, token, ',')) return false;
-            value = std::stoi(token);
-            if (value < 0 || value > 255) return false;
-            color.b = static_cast<uint8_t>(value);
+    pool.run(chunkCount, [&](size_t i) {
+        firstValue[i + 1] = std::count(bounds[i], bounds[i + 1], ',');
+    });
+    for (int i = 0; i < chunkCount; i++) {
+        firstValue[i + 1] += firstValue[i];
+    }
+    if (firstValue[chunkCount] != valueCount) return false;
+
+    // Channels are written as bytes straight into the packed pixels, which
+    // hold r, g, b, a in memory order on little-endian machines
+    std::vector<uint32_t> newPixels((size_t)newSize * newSize);
+    uint8_t* channels = (uint8_t*)newPixels.data();
+    std::vector<uint8_t> unpacked;
+    if (std::endian::native != std::endian::little) {
+        unpacked.resize(valueCount);
+        channels = unpacked.data();
+    }
 
-            // Read a
-            if (!std::getline(ss, token, ',')) return false;
-            value = std::stoi(token);
-            if (value < 0 || value > 255) return false;
-            color.a = static_cast<uint8_t>(value);
+    pool.run(chunkCount, [&](size_t i) {
+        chunkOk[i] = parseChannels(bounds[i], bounds[i + 1], channels + firstValue[i]);
+    });
+    if (std::find(chunkOk.begin(), chunkOk.end(), 0) != chunkOk.end()) return false;
 
-            newPixels.push_back(color);
+    if (!unpacked.empty()) {
+        for (size_t i = 0; i < newPixels.size(); i++) {
+            newPixels[i] = Color(unpacked[i * 4], unpacked[i * 4 + 1], unpacked[i * 4 + 2], unpacked[i * 4 + 3]).toImU32();
         }
+    }
 
-        // If we've read all pixels successfully, update the crosshair
-        m_pixels = std::move(newPixels);
-        m_size = newSize;
+    size = newSize;
+    pixels = std::move(newPixels);
+    return true;
+}
+
+// One value the way std::stoi read it: leading whitespace and a sign are
+// skipped, anything after the digits is ignored
+static bool parseLenientValue(std::string_view token, int& value) {
+    size_t i = 0;
+    while (i < token.size() && std::isspace((unsigned char)token[i])) i++;
+
+    bool negative = i < token.size() && token[i] == '-';
+    if (i < token.size() && (token[i] == '-' || token[i] == '+')) i++;
+
+    auto [next, error] = std::from_chars(token.data() + i, token.data() + token.size(), value);
+    if (error != std::errc()) return false;
+
+    value = negative ? -value : value;
+    return true;
+}
 
-        return true;
+// Version 1 read every value with std::stoi, so text presets written by hand
+// or other tools may have whitespace or junk around values, or values past the
+// last pixel. All of that is accepted here, more slowly than by parseExact.
+static bool parseLenient(std::string_view data, int& size, std::vector<uint32_t>& pixels) {
+    size_t pos = 0;
+    auto next = [&](int& value) {
+        if (pos > data.size()) return false;
+
+        size_t comma = std::min(data.find(',', pos), data.size());
+        bool parsed = parseLenientValue(data.substr(pos, comma - pos), value);
+        pos = comma + 1;
+        return parsed;
+    };
+
+    int newSize;
+    if (!next(newSize) || newSize <= 0 || newSize > PresetFormat::MAX_SIZE) return false;
+
+    std::vector<uint32_t> newPixels((size_t)newSize * newSize);
+    for (uint32_t& pixel : newPixels) {
+        int r, g, b, a;
+        if (!next(r) || !next(g) || !next(b) || !next(a)) return false;
+
+        // Negative values have bits above the low byte too
+        if ((r | g | b | a) & ~0xFF) return false;
+        pixel = Color((uint8_t)r, (uint8_t)g, (uint8_t)b, (uint8_t)a).toImU32();
     }
-    catch (const std::exception&) {
+
+    size = newSize;
+    pixels = std::move(newPixels);
+    return true;
+}
+
+bool Crosshair::deserialize(std::string_view data) {
+    // Format: size,r,g,b,a,r,g,b,a,...
+    int newSize;
+    std::vector<uint32_t> newPixels;
+    if (!parseExact(data, newSize, newPixels) && !parseLenient(data, newSize, newPixels)) {
         return false;
     }
+
+    // If we've read all pixels successfully, update the crosshair
+    assignPixels(newSize, newPixels);
+    return true;
+}
+
+std::string Crosshair::serializeBinary() const {
+    std::string data;
+    StringSink sink(data);
+    serializeBinary(sink);
+    sink.finish();
+    return data;
+}
+
+void Crosshair::serializeBinary(PresetSink& sink) const {
+    PresetFormat::encode(m_size, [this](int y, uint32_t* out) {
+        m_pixels.readRow(y, 0, m_size, out);
+    }, sink);
+}
+
+bool Crosshair::deserializeBinary(std::string_view data) {
+    int newSize;
+    std::span<const uint32_t> newPixels;
+    std::vector<uint32_t> decoded;
+    if (!PresetFormat::decodeView(data, newSize, newPixels, decoded)) return false;
+
+    assignPixels(newSize, newPixels);
+    return true;
 }
\ No newline at end of file
@@ -2,24 +2,27 @@
 
 #include <vector>
 #include <string>
+#include <string_view>
 #include <memory>
 #include <cstdint>
+#include <array>
+#include <span>
+#include "pixel.h"
+#include "pixelStorage.h"
+#include "pixelTexture.h"
 
-// RGBA color representation
-struct Color {
-    uint8_t r, g, b, a;
-
-    Color() : r(0), g(0), b(0), a(0) {}
-    Color(uint8_t r, uint8_t g, uint8_t b, uint8_t a = 255) : r(r), g(g), b(b), a(a) {}
-
-    // Convert color to uint32_t representation (for ImGui)
-    uint32_t toImU32() const;
-};
+struct ImDrawList;
+class PresetSink;
 
 class Crosshair {
 public:
     static const int DEFAULT_SIZE = 64;  // Default grid size (64x64)
 
+    // Text presets with at least this many channel values are parsed in
+    // parallel, each chunk at least PARALLEL_PARSE_MIN_CHUNK bytes
+    static constexpr size_t PARALLEL_PARSE_MIN_VALUES = 256 * 256 * 4;
+    static constexpr size_t PARALLEL_PARSE_MIN_CHUNK = 256 * 1024;
+
     Crosshair();
     ~Crosshair();
 
@@ -32,25 +35,175 @@ public:
     // Get pixel at position
     Color getPixel(int x, int y) const;
 
+    // Unchecked packed access (see pixel.h) for inner loops; coordinates must be
+    // inside the grid
+    uint32_t getPixelUnchecked(int x, int y) const { return m_pixels.get(x, y); }
+    void setPixelUnchecked(int x, int y, uint32_t color);
+
+    // Packed pixels [x, x + count) of row y, unchecked. The view points into the
+    // storage when possible, otherwise into scratch (which must hold count pixels);
+    // it is valid until the next change
+    std::span<const uint32_t> getRow(int y, int x, int count, uint32_t* scratch) const {
+        return m_pixels.getRow(y, x, count, scratch);
+    }
+
+    // Call fn(startX, endX) for every run of non-transparent pixels in row y
+    template <typename Fn>
+    void forEachOpaqueSpan(int y, Fn&& fn) const { m_pixels.forEachSpan(y, fn); }
+
     // Clear all pixels
     void clear();
 
+    // Set every pixel of a rectangle (clipped to the grid) to color
+    void fillRect(const PixelRect& rect, const Color& color);
+
+    // Replace every pixel of one opaque color with another, returning the count
+    int replaceColor(const Color& from, const Color& to);
+
+    // Scale the opacity of every pixel by factor / 255
+    void multiplyAlpha(uint8_t factor);
+
     // Resize grid (preserves content where possible)
     void resize(int newSize);
 
+    // All size * size packed pixels, row-major
+    std::vector<uint32_t> getPixels() const;
+
+    // Replace the whole grid with size * size packed pixels
+    void assignPixels(int size, std::span<const uint32_t> pixels);
+
+    // Overwrite a rectangle inside the grid with the same rectangle of a
+    // row-major grid of packed pixels, a row at a time
+    void writeRect(const PixelRect& rect, const uint32_t* pixels, int stride);
+
+    // Exchange grids with another crosshair without copying pixels, so a grid
+    // prepared on another thread can be switched in at once. Both publish a
+    // change of the whole grid; neither may be in a batch.
+    void swapPixels(Crosshair& other);
+
     // Get current size
     int getSize() const { return m_size; }
 
+    // Tight bounding box of all non-transparent pixels (empty if none)
+    PixelRect getOpaqueBounds() const;
+
+    // Number of non-transparent pixels
+    int getOpaqueCount() const { return m_opaqueCount; }
+
+    // Internal pixel representation and its size in bytes
+    PixelFormat getStorageFormat() const { return m_pixels.getFormat(); }
+    size_t getStorageBytes() const { return m_pixels.getMemoryUsage(); }
+
+    // 64-bit hash of the size and pixels (see contentHash.h), equal for
+    // pixel-identical crosshairs; cached until the next change
+    uint64_t getContentHash() const;
+
+    // Change tracking: every published change bumps the generation by one
+    uint64_t getGeneration() const { return m_generation; }
+
+    // Union of everything changed after the given generation (0 = everything)
+    PixelRect getDirtyRect(uint64_t sinceGeneration) const;
+
+    // Group several writes so they publish one dirty region and one generation
+    // bump on commit. Batches may nest; only the outermost commit publishes.
+    void beginBatch();
+    void commitBatch();
+    bool isInBatch() const { return m_batchDepth > 0; }
+
     // Draw crosshair at specified position
     void draw(float posX, float posY, float scale = 1.0f);
 
+    // Draw crosshair into a specific draw list
+    void draw(ImDrawList* drawList, float posX, float posY, float scale = 1.0f);
+
+    // Number of vertices in the cached draw mesh (rebuilt if pixels changed)
+    int getMeshVertexCount();
+
+    // Attach a renderer texture; draw() then uses a single textured quad
+    // instead of the mesh and only re-uploads pixels that changed
+    void setTexture(std::shared_ptr<PixelTexture> texture);
+
     // Serialize to string (for saving)
     std::string serialize() const;
 
-    // Deserialize from string (for loading)
-    bool deserialize(const std::string& data);
+    // Stream the same text into a sink; the caller finishes the sink
+    void serialize(PresetSink& sink) const;
+
+    // Deserialize from string (for loading). Grids of PARALLEL_PARSE_MIN_VALUES
+    // channels or more are parsed on the shared thread pool (see threadPool.h).
+    // Anything std::stoi took from version 1 files is accepted as well, by a
+    // slower sequential pass.
+    bool deserialize(std::string_view data);
+
+    // Serialize to the binary preset format (see presetFormat.h)
+    std::string serializeBinary() const;
+    void serializeBinary(PresetSink& sink) const;
+
+    // Deserialize from the binary preset format; leaves the crosshair unchanged
+    // if the data is malformed or fails its checksum. Raw payloads are read in
+    // place, so data can point straight into a mapped file.
+    bool deserializeBinary(std::string_view data);
 
 private:
-    std::vector<Color> m_pixels;
+    // Vertex of the cached mesh, in grid units relative to the top-left corner
+    struct MeshVertex {
+        float x, y;
+        uint32_t col;
+    };
+
+    // Dirty region published by one generation
+    struct DirtyEntry {
+        uint64_t generation;
+        PixelRect rect;
+    };
+
+    static constexpr int DIRTY_HISTORY_SIZE = 64;
+
+    PixelStorage m_pixels;
     int m_size;
-};
\ No newline at end of file
+
+    // Coverage statistics, maintained as pixels are written. Erasing a pixel on
+    // the edge of the bounds only flags them; they are shrunk on next query.
+    int m_opaqueCount;
+    mutable PixelRect m_opaqueBounds;
+    mutable bool m_opaqueBoundsStale;
+
+    // Change tracking
+    uint64_t m_generation;
+    int m_batchDepth;
+    PixelRect m_pendingDirty;
+    std::array<DirtyEntry, DIRTY_HISTORY_SIZE> m_dirtyHistory;
+    int m_dirtyHistoryCount;
+
+    // Cached draw mesh: same-colored pixels merged into rectangles
+    std::vector<MeshVertex> m_meshVertices;
+    std::vector<uint32_t> m_meshIndices;
+    uint64_t m_meshGeneration;
+    std::vector<uint32_t> m_mergePixels;
+    std::vector<std::span<const uint32_t>> m_mergeRows;
+    std::vector<uint8_t> m_mergeCovered;
+
+    // Texture mirror of m_pixels and the generation it was last synced to
+    std::shared_ptr<PixelTexture> m_texture;
+    uint64_t m_textureGeneration;
+    std::vector<uint32_t> m_uploadBuffer;
+
+    // Content hash and the generation it was computed for (0 = none)
+    mutable uint64_t m_contentHash;
+    mutable uint64_t m_contentHashGeneration;
+
+    // Rebuild the cached mesh from the current pixels
+    void rebuildMesh();
+
+    // Merge one region of the grid into rectangles and append them to the mesh
+    void mergeRegion(const PixelRect& region);
+
+    // Recompute bounds and count by scanning the given region
+    void recomputeCoverage(const PixelRect& region);
+
+    // Record a changed region and publish it unless a batch is open
+    void markDirty(const PixelRect& rect);
+
+    // Bump the generation for the pending dirty region
+    void publishDirty();
+};
\ No newline at end of file
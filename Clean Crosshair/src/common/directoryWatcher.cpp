@@ -0,0 +1,284 @@
+#include "directoryWatcher.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/inotify.h>
+#include <poll.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cerrno>
+#endif
+
+DirectoryWatcher::DirectoryWatcher()
+    : m_overflowed(false),
+#ifdef _WIN32
+    m_directory(INVALID_HANDLE_VALUE),
+    m_stopEvent(NULL) {
+#else
+    m_inotify(-1),
+    m_stopPipe{ -1, -1 } {
+#endif
+}
+
+DirectoryWatcher::~DirectoryWatcher() {
+    stop();
+}
+
+void DirectoryWatcher::record(const std::string& name, Change change) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_lastChange = std::chrono::steady_clock::now();
+
+    // A rescan will see this change anyway
+    if (m_overflowed) return;
+
+    auto it = m_pending.find(name);
+    if (it == m_pending.end()) {
+        m_pending[name] = change;
+    }
+    else if (it->second == Change::Added && change == Change::Removed) {
+        // Came and went before anyone looked
+        m_pending.erase(it);
+    }
+    else if (it->second == Change::Added && change == Change::Modified) {
+        // Still new to the caller
+    }
+    else if (it->second == Change::Removed && change == Change::Added) {
+        // Replaced, e.g. by a rename over it
+        it->second = Change::Modified;
+    }
+    else {
+        it->second = change;
+    }
+}
+
+void DirectoryWatcher::recordOverflow() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_overflowed = true;
+    m_pending.clear();
+    m_lastChange = std::chrono::steady_clock::now();
+}
+
+std::vector<DirectoryWatcher::Event> DirectoryWatcher::poll() {
+    std::vector<Event> events;
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    if ((m_pending.empty() && !m_overflowed)
+        || std::chrono::steady_clock::now() - m_lastChange < std::chrono::milliseconds(DEBOUNCE_MS)) {
+        return events;
+    }
+
+    if (m_overflowed) {
+        m_overflowed = false;
+        events.push_back({ Change::Overflow, std::string() });
+        return events;
+    }
+
+    events.reserve(m_pending.size());
+    for (const auto& [name, change] : m_pending) {
+        events.push_back({ change, name });
+    }
+    m_pending.clear();
+    return events;
+}
+
+#ifdef _WIN32
+
+bool DirectoryWatcher::start(const std::string& directory) {
+    stop();
+
+    m_directory = CreateFileA(directory.c_str(), FILE_LIST_DIRECTORY,
+        FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, NULL, OPEN_EXISTING,
+        FILE_FLAG_BACKUP_SEMANTICS | FILE_FLAG_OVERLAPPED, NULL);
+    if (m_directory == INVALID_HANDLE_VALUE) {
+        return false;
+    }
+
+    m_stopEvent = CreateEventA(NULL, TRUE, FALSE, NULL);
+    if (!m_stopEvent) {
+        CloseHandle(m_directory);
+        m_directory = INVALID_HANDLE_VALUE;
+        return false;
+    }
+
+    m_thread = std::thread(&DirectoryWatcher::run, this);
+    return true;
+}
+
+void DirectoryWatcher::stop() {
+    if (m_thread.joinable()) {
+        SetEvent(m_stopEvent);
+        m_thread.join();
+    }
+
+    if (m_stopEvent) {
+        CloseHandle(m_stopEvent);
+        m_stopEvent = NULL;
+    }
+    if (m_directory != INVALID_HANDLE_VALUE) {
+        CloseHandle(m_directory);
+        m_directory = INVALID_HANDLE_VALUE;
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_pending.clear();
+    m_overflowed = false;
+}
+
+void DirectoryWatcher::run() {
+    // FILE_NOTIFY_INFORMATION records must be DWORD aligned
+    alignas(DWORD) char buffer[16 * 1024];
+
+    OVERLAPPED overlapped = {};
+    overlapped.hEvent = CreateEventA(NULL, TRUE, FALSE, NULL);
+    if (!overlapped.hEvent) return;
+
+    HANDLE waitHandles[2] = { overlapped.hEvent, m_stopEvent };
+    const DWORD filter = FILE_NOTIFY_CHANGE_FILE_NAME | FILE_NOTIFY_CHANGE_LAST_WRITE | FILE_NOTIFY_CHANGE_SIZE;
+
+    for (;;) {
+        ResetEvent(overlapped.hEvent);
+        if (!ReadDirectoryChangesW(m_directory, buffer, sizeof(buffer), FALSE, filter, NULL, &overlapped, NULL)) {
+            break;
+        }
+
+        if (WaitForMultipleObjects(2, waitHandles, FALSE, INFINITE) != WAIT_OBJECT_0) {
+            CancelIo(m_directory);
+            GetOverlappedResult(m_directory, &overlapped, NULL, TRUE);
+            break;
+        }
+
+        DWORD length = 0;
+        if (!GetOverlappedResult(m_directory, &overlapped, &length, FALSE)) {
+            if (GetLastError() != ERROR_NOTIFY_ENUM_DIR) {
+                break;
+            }
+            length = 0;
+        }
+
+        // An overflowed buffer reports nothing, so the caller has to rescan
+        if (length == 0) {
+            recordOverflow();
+            continue;
+        }
+
+        size_t offset = 0;
+        while (length > 0) {
+            const FILE_NOTIFY_INFORMATION* info = (const FILE_NOTIFY_INFORMATION*)(buffer + offset);
+
+            int wideLength = (int)(info->FileNameLength / sizeof(WCHAR));
+            int nameLength = WideCharToMultiByte(CP_UTF8, 0, info->FileName, wideLength, NULL, 0, NULL, NULL);
+            std::string name(nameLength, '\0');
+            WideCharToMultiByte(CP_UTF8, 0, info->FileName, wideLength, name.data(), nameLength, NULL, NULL);
+
+            switch (info->Action) {
+            case FILE_ACTION_ADDED:
+            case FILE_ACTION_RENAMED_NEW_NAME:
+                record(name, Change::Added);
+                break;
+            case FILE_ACTION_REMOVED:
+            case FILE_ACTION_RENAMED_OLD_NAME:
+                record(name, Change::Removed);
+                break;
+            case FILE_ACTION_MODIFIED:
+                record(name, Change::Modified);
+                break;
+            }
+
+            if (info->NextEntryOffset == 0) break;
+            offset += info->NextEntryOffset;
+        }
+    }
+
+    CloseHandle(overlapped.hEvent);
+}
+
+#else
+
+bool DirectoryWatcher::start(const std::string& directory) {
+    stop();
+
+    m_inotify = inotify_init1(IN_CLOEXEC);
+    if (m_inotify < 0) {
+        return false;
+    }
+
+    // Whole writes only: IN_CLOSE_WRITE rather than every IN_MODIFY
+    const uint32_t mask = IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_CLOSE_WRITE;
+    if (inotify_add_watch(m_inotify, directory.c_str(), mask) < 0 || pipe(m_stopPipe) != 0) {
+        stop();
+        return false;
+    }
+
+    m_thread = std::thread(&DirectoryWatcher::run, this);
+    return true;
+}
+
+void DirectoryWatcher::stop() {
+    if (m_thread.joinable()) {
+        char wake = 0;
+        (void)!write(m_stopPipe[1], &wake, 1);
+        m_thread.join();
+    }
+
+    for (int* fd : { &m_inotify, &m_stopPipe[0], &m_stopPipe[1] }) {
+        if (*fd >= 0) {
+            close(*fd);
+            *fd = -1;
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_pending.clear();
+    m_overflowed = false;
+}
+
+void DirectoryWatcher::run() {
+    alignas(inotify_event) char buffer[16 * 1024];
+
+    pollfd fds[2] = {
+        { m_inotify, POLLIN, 0 },
+        { m_stopPipe[0], POLLIN, 0 }
+    };
+
+    for (;;) {
+        // A signal interrupting the wait is not a reason to stop watching
+        int ready = ::poll(fds, 2, -1);
+        if (ready < 0 && errno == EINTR) continue;
+        if (ready < 0 || (fds[1].revents & POLLIN)) {
+            break;
+        }
+
+        ssize_t length = read(m_inotify, buffer, sizeof(buffer));
+        if (length < 0 && errno == EINTR) continue;
+        if (length <= 0) {
+            break;
+        }
+
+        for (ssize_t offset = 0; offset < length;) {
+            const inotify_event* event = (const inotify_event*)(buffer + offset);
+            offset += sizeof(inotify_event) + event->len;
+
+            // The kernel queue filled up and dropped events
+            if (event->mask & IN_Q_OVERFLOW) {
+                recordOverflow();
+                continue;
+            }
+
+            if (event->len == 0 || (event->mask & IN_ISDIR)) continue;
+            std::string name(event->name);
+
+            if (event->mask & (IN_CREATE | IN_MOVED_TO)) {
+                record(name, Change::Added);
+            }
+            else if (event->mask & (IN_DELETE | IN_MOVED_FROM)) {
+                record(name, Change::Removed);
+            }
+            else if (event->mask & IN_CLOSE_WRITE) {
+                record(name, Change::Modified);
+            }
+        }
+    }
+}
+
+#endif
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <map>
+#include <thread>
+#include <mutex>
+#include <chrono>
+
+// Reports files added, removed or modified in one directory (not its
+// subdirectories), using ReadDirectoryChangesW on Windows and inotify
+// elsewhere. Changes are collected on a background thread and handed out by
+// poll() only once the directory has been quiet for DEBOUNCE_MS, with each
+// file reported once, so a bulk copy arrives as a single batch. When more
+// changes arrive than the system could queue, the batch is a single Overflow
+// event instead, and the caller has to rescan the directory.
+class DirectoryWatcher {
+public:
+    static constexpr int DEBOUNCE_MS = 250;
+
+    enum class Change {
+        Added,
+        Removed,
+        Modified,
+        Overflow   // Changes were lost; name is empty
+    };
+
+    struct Event {
+        Change change;
+        std::string name;  // File name within the directory
+    };
+
+    DirectoryWatcher();
+    ~DirectoryWatcher();
+
+    DirectoryWatcher(const DirectoryWatcher&) = delete;
+    DirectoryWatcher& operator=(const DirectoryWatcher&) = delete;
+
+    // Start watching a directory, replacing any previous one
+    bool start(const std::string& directory);
+
+    void stop();
+
+    bool isRunning() const { return m_thread.joinable(); }
+
+    // Changes that have settled since the last call; empty while files are
+    // still changing
+    std::vector<Event> poll();
+
+private:
+    // Latest change per file, merged as events arrive
+    std::map<std::string, Change> m_pending;
+    bool m_overflowed;
+    std::chrono::steady_clock::time_point m_lastChange;
+    std::mutex m_mutex;
+
+    std::thread m_thread;
+
+#ifdef _WIN32
+    void* m_directory;
+    void* m_stopEvent;
+#else
+    int m_inotify;
+    int m_stopPipe[2];
+#endif
+
+    // Wait for changes until stop() is called
+    void run();
+
+    // Merge one change into m_pending
+    void record(const std::string& name, Change change);
+
+    // Note that changes were lost, which replaces every pending change
+    void recordOverflow();
+};
@@ -0,0 +1,186 @@
+#include "editJournal.h"
+#include "crosshair.h"
+#include "presetFormat.h"
+#include "presetSink.h"
+#include "mappedFile.h"
+#include <algorithm>
+#include <cstring>
+
+static constexpr char JOURNAL_MAGIC[4] = { 'C', 'C', 'J', 'R' };
+static constexpr uint16_t JOURNAL_VERSION = 1;
+
+// Record payload before the runs
+static constexpr size_t RECORD_HEADER_SIZE = 11;
+
+static uint16_t get16(const unsigned char* p) {
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static uint32_t get32(const unsigned char* p) {
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static uint64_t get64(const unsigned char* p) {
+    return get32(p) | ((uint64_t)get32(p + 4) << 32);
+}
+
+EditJournal::EditJournal() {
+}
+
+std::string EditJournal::encodeRecord(uint8_t tool, const Crosshair& crosshair, const PixelRect& rect) {
+    int size = crosshair.getSize();
+    PixelRect clipped(std::max(rect.minX, 0), std::max(rect.minY, 0),
+        std::min(rect.maxX, size), std::min(rect.maxY, size));
+    if (clipped.isEmpty()) {
+        clipped = PixelRect();
+    }
+
+    std::string payload;
+    StringSink sink(payload);
+    sink.put((char)tool);
+    sink.put16((uint16_t)size);
+    sink.put16((uint16_t)clipped.minX);
+    sink.put16((uint16_t)clipped.minY);
+    sink.put16((uint16_t)clipped.width());
+    sink.put16((uint16_t)clipped.height());
+
+    // Runs continue across rows, so a flat fill is a handful of bytes
+    std::vector<uint32_t> scratch(std::max(clipped.width(), 0));
+    uint32_t runColor = 0;
+    uint16_t runLength = 0;
+    for (int y = clipped.minY; y < clipped.maxY; y++) {
+        for (uint32_t color : crosshair.getRow(y, clipped.minX, clipped.width(), scratch.data())) {
+            if (runLength > 0 && (color != runColor || runLength == UINT16_MAX)) {
+                sink.put16(runLength);
+                sink.put32(runColor);
+                runLength = 0;
+            }
+            runColor = color;
+            runLength++;
+        }
+    }
+    if (runLength > 0) {
+        sink.put16(runLength);
+        sink.put32(runColor);
+    }
+    sink.finish();
+
+    std::string record;
+    StringSink recordSink(record);
+    recordSink.put32((uint32_t)payload.size());
+    recordSink.put32(PresetFormat::crc32(payload.data(), payload.size()));
+    recordSink.write(payload.data(), payload.size());
+    recordSink.finish();
+    return record;
+}
+
+bool EditJournal::reset(const std::string& path, const std::string& baseName, uint64_t baseHash,
+    const std::string& records) {
+    close();
+
+    bool written = FileSink::writeAtomic(path, [&](PresetSink& sink) {
+        sink.write(JOURNAL_MAGIC, sizeof(JOURNAL_MAGIC));
+        sink.put16(JOURNAL_VERSION);
+        sink.put16((uint16_t)std::min<size_t>(baseName.size(), UINT16_MAX));
+        sink.write(baseName.data(), std::min<size_t>(baseName.size(), UINT16_MAX));
+        sink.put64(baseHash);
+        sink.write(records.data(), records.size());
+    });
+    if (!written) {
+        return false;
+    }
+
+    m_file.open(path, std::ios::binary | std::ios::app);
+    return m_file.is_open();
+}
+
+bool EditJournal::append(const std::string& record) {
+    if (!m_file.is_open()) {
+        return false;
+    }
+
+    m_file.write(record.data(), record.size());
+    m_file.flush();
+    return !m_file.fail();
+}
+
+void EditJournal::close() {
+    if (m_file.is_open()) {
+        m_file.close();
+    }
+    m_file.clear();
+}
+
+bool EditJournal::read(const std::string& path, std::string& baseName, uint64_t& baseHash,
+    std::vector<Record>& records) {
+    records.clear();
+
+    MappedFile file;
+    if (!file.open(path)) {
+        return false;
+    }
+
+    std::string_view data = file.getData();
+    const unsigned char* p = (const unsigned char*)data.data();
+    if (data.size() < 8 || std::memcmp(p, JOURNAL_MAGIC, sizeof(JOURNAL_MAGIC)) != 0
+        || get16(p + 4) != JOURNAL_VERSION) {
+        return false;
+    }
+
+    size_t nameLength = get16(p + 6);
+    if (data.size() < 8 + nameLength + 8) {
+        return false;
+    }
+    baseName.assign(data.data() + 8, nameLength);
+    baseHash = get64(p + 8 + nameLength);
+
+    size_t offset = 8 + nameLength + 8;
+    while (data.size() - offset >= 8) {
+        uint32_t payloadSize = get32(p + offset);
+        uint32_t crc = get32(p + offset + 4);
+        if (payloadSize < RECORD_HEADER_SIZE || data.size() - offset - 8 < payloadSize) break;
+
+        const unsigned char* payload = p + offset + 8;
+        if (PresetFormat::crc32(payload, payloadSize) != crc) break;
+
+        Record record;
+        record.tool = payload[0];
+        record.gridSize = get16(payload + 1);
+        int x = get16(payload + 3);
+        int y = get16(payload + 5);
+        int width = get16(payload + 7);
+        int height = get16(payload + 9);
+        record.rect = PixelRect(x, y, x + width, y + height);
+        if (record.gridSize <= 0 || record.rect.maxX > record.gridSize || record.rect.maxY > record.gridSize) break;
+
+        // The runs must cover the region exactly
+        size_t expected = (size_t)width * height;
+        record.pixels.reserve(expected);
+        for (size_t run = RECORD_HEADER_SIZE; run + 6 <= payloadSize; run += 6) {
+            uint16_t count = get16(payload + run);
+            if (record.pixels.size() + count > expected) break;
+            record.pixels.insert(record.pixels.end(), count, get32(payload + run + 2));
+        }
+        if (record.pixels.size() != expected) break;
+
+        records.push_back(std::move(record));
+        offset += 8 + payloadSize;
+    }
+
+    return true;
+}
+
+void EditJournal::apply(const Record& record, Crosshair& crosshair) {
+    if (crosshair.getSize() != record.gridSize) {
+        crosshair.resize(record.gridSize);
+    }
+
+    crosshair.beginBatch();
+    const uint32_t* pixel = record.pixels.data();
+    for (int y = record.rect.minY; y < record.rect.maxY; y++) {
+        for (int x = record.rect.minX; x < record.rect.maxX; x++) {
+            crosshair.setPixelUnchecked(x, y, *pixel++);
+        }
+    }
+    crosshair.commitBatch();
+}
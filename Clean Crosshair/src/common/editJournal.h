@@ -0,0 +1,74 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <fstream>
+#include <cstdint>
+#include "pixel.h"
+
+class Crosshair;
+
+// Append-only log of edits made on top of a saved preset, so unsaved work
+// survives a crash. Each record holds only the region an edit changed, so
+// logging costs what the edit touched rather than the whole grid; a
+// checkpoint starts the log over from a single record of the whole grid.
+//
+// Layout, all integers little-endian:
+//    0  char[4]  magic "CCJR"
+//    4  uint16   version
+//    6  uint16   base preset name length
+//    8  name, then uint64 content hash of the base preset
+//       records: uint32 payload size, uint32 CRC-32 of the payload, payload
+//
+// Record payload: uint8 tool, uint16 grid size, uint16 x, y, width, height,
+// then runs of uint16 count and uint32 packed pixel covering the region row
+// by row.
+//
+// Only the tail can be torn by a crash; reading stops at the first record
+// that is incomplete or fails its checksum.
+class EditJournal {
+public:
+    // Tool of changes not made with an editor tool, and of checkpoints
+    static constexpr uint8_t TOOL_OTHER = 0xFF;
+
+    // Size past which owners should checkpoint rather than keep appending
+    static constexpr size_t CHECKPOINT_BYTES = 256 * 1024;
+
+    struct Record {
+        uint8_t tool;
+        int gridSize;
+        PixelRect rect;
+        std::vector<uint32_t> pixels;  // rect's pixels, row-major
+    };
+
+    EditJournal();
+
+    EditJournal(const EditJournal&) = delete;
+    EditJournal& operator=(const EditJournal&) = delete;
+
+    // Encode a record of one region of the crosshair (clipped to the grid)
+    static std::string encodeRecord(uint8_t tool, const Crosshair& crosshair, const PixelRect& rect);
+
+    // Replace the file with a new journal on top of a base preset, starting
+    // with records (already encoded, may be empty), and keep it open for
+    // appending
+    bool reset(const std::string& path, const std::string& baseName, uint64_t baseHash,
+        const std::string& records = std::string());
+
+    // Append one encoded record, flushed to the file before returning
+    bool append(const std::string& record);
+
+    void close();
+
+    // Read a journal. False if it is missing or its header is unreadable.
+    static bool read(const std::string& path, std::string& baseName, uint64_t& baseHash,
+        std::vector<Record>& records);
+
+    // Replay one record, resizing the grid first if it was recorded at
+    // another size
+    static void apply(const Record& record, Crosshair& crosshair);
+
+private:
+    std::ofstream m_file;
+};
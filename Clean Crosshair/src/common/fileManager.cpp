@@ -3,16 +3,47 @@
 #include <fstream>
 #include <filesystem>
 #include <direct.h>
+#include <map>
+#include <unordered_set>
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <charconv>
+#include "presetFormat.h"
+#include "presetSink.h"
+#include "mappedFile.h"
+#include "contentHash.h"
+#include "threadPool.h"
 
-FileManager::FileManager() {
+// Parse a preset file in either format
+static bool parsePreset(std::string_view data, Crosshair& crosshair) {
+    if (PresetFormat::isBinary(data)) {
+        return crosshair.deserializeBinary(data);
+    }
+
+    // Version 1: CSV text on a single line
+    return crosshair.deserialize(data.substr(0, data.find_first_of("\r\n")));
+}
+
+FileManager::FileManager()
+    : m_stopMigration(false) {
     m_appDataPath = getAppDataDirectory() + "\\CleanCrosshair";
     m_presetsPath = m_appDataPath + "\\Presets";
     m_settingsPath = m_appDataPath + "\\settings.cfg";
+    m_migrationMarkerPath = m_appDataPath + "\\presets.v3";
+    m_libraryPath = m_appDataPath + "\\presets.cclib";
+    m_thumbnailsPath = m_appDataPath + "\\Thumbnails";
+    m_journalPath = m_appDataPath + "\\Journal\\edits.journal";
 
     initializeDirectories();
 }
 
 FileManager::~FileManager() {
+    // Stop between files; a file being converted is finished first
+    m_stopMigration = true;
+    if (m_migrationThread.joinable()) {
+        m_migrationThread.join();
+    }
 }
 
 std::string FileManager::getAppDataDirectory() const {
@@ -42,6 +73,13 @@ bool FileManager::initializeDirectories() {
         }
     }
 
+    // Thumbnails are only a cache, so failing to create their directory is fine
+    std::error_code error;
+    std::filesystem::create_directory(m_thumbnailsPath, error);
+
+    // Without its directory the journal is simply not written
+    std::filesystem::create_directory(std::filesystem::path(m_journalPath).parent_path(), error);
+
     return true;
 }
 
@@ -57,43 +95,549 @@ std::string FileManager::getPresetPath(const std::string& name) const {
     return m_presetsPath + "\\" + safeName + ".crosshair";
 }
 
+std::string FileManager::getThumbnailPath(uint64_t hash) const {
+    char name[17];
+    snprintf(name, sizeof(name), "%016llx", (unsigned long long)hash);
+    return m_thumbnailsPath + "\\" + name + ".thumb";
+}
+
 bool FileManager::savePreset(const std::string& name, const Crosshair& crosshair) {
-    std::string filePath = getPresetPath(name);
-    std::ofstream file(filePath);
+    std::lock_guard<std::shared_mutex> lock(m_fileMutex);
+    forgetPresetHash(name);
+
+    if (m_library.isOpen()) {
+        return m_library.put(name, crosshair.serializeBinary(), crosshair.getContentHash());
+    }
+
+    return FileSink::writeAtomic(getPresetPath(name), [&](PresetSink& sink) {
+        crosshair.serializeBinary(sink);
+    });
+}
 
-    if (!file.is_open()) {
+bool FileManager::loadPreset(const std::string& name, Crosshair& crosshair) {
+    std::shared_ptr<const PixelCache::Pixels> pixels = readPreset(name);
+    if (!pixels) {
         return false;
     }
 
-    // Write serialized crosshair data
-    file << crosshair.serialize();
-    file.close();
+    crosshair.assignPixels(pixels->size, pixels->data);
+    return true;
+}
+
+std::shared_ptr<const PixelCache::Pixels> FileManager::readPreset(const std::string& name) {
+    std::shared_ptr<const PixelCache::Pixels> pixels = findCachedPreset(name);
+    if (pixels) {
+        return pixels;
+    }
+
+    std::shared_lock<std::shared_mutex> lock(m_fileMutex);
+    return decodePreset(name);
+}
+
+std::shared_ptr<const PixelCache::Pixels> FileManager::findCachedPreset(const std::string& name) {
+    uint64_t hash;
+    {
+        std::lock_guard<std::mutex> lock(m_cacheMutex);
+        auto it = m_presetHashes.find(name);
+        if (it == m_presetHashes.end()) {
+            return nullptr;
+        }
+        hash = it->second;
+    }
+
+    return m_pixelCache.find(hash);
+}
+
+std::shared_ptr<const PixelCache::Pixels> FileManager::decodePreset(const std::string& name) {
+    if (m_library.isOpen()) {
+        return readLibraryPreset(name);
+    }
+
+    MappedFile file;
+    if (!file.open(getPresetPath(name))) {
+        return nullptr;
+    }
+
+    // Presets saved with their hash share the pixels of one decoded before
+    std::string_view data = file.getData();
+    uint64_t hash;
+    bool hashStored = PresetFormat::readContentHash(data, hash);
+    if (hashStored) {
+        std::shared_ptr<const PixelCache::Pixels> cached = m_pixelCache.find(hash);
+        if (cached) {
+            setPresetHash(name, hash);
+            return cached;
+        }
+    }
+
+    int size;
+    std::vector<uint32_t> pixels;
+
+    if (PresetFormat::isBinary(data)) {
+        if (!PresetFormat::decode(data, size, pixels)) {
+            return nullptr;
+        }
+    }
+    else {
+        Crosshair crosshair;
+        if (!parsePreset(data, crosshair)) {
+            return nullptr;
+        }
+        size = crosshair.getSize();
+        pixels = crosshair.getPixels();
+    }
+
+    // CSV and version 2 presets carry no hash, so hash the decoded pixels
+    if (!hashStored) {
+        ContentHasher hasher(size);
+        for (int y = 0; y < size; y++) {
+            hasher.addRow(pixels.data() + (size_t)y * size, size);
+        }
+        hash = hasher.finish();
+    }
+
+    setPresetHash(name, hash);
+    return m_pixelCache.insert(hash, size, std::move(pixels));
+}
+
+std::shared_ptr<const PixelCache::Pixels> FileManager::readLibraryPreset(const std::string& name) {
+    const PresetLibrary::Entry* entry = m_library.find(name);
+    if (!entry) {
+        return nullptr;
+    }
+
+    // Presets with the same content share one decoded buffer
+    std::shared_ptr<const PixelCache::Pixels> pixels = m_pixelCache.find(entry->contentHash);
+    if (!pixels) {
+        int size;
+        std::vector<uint32_t> decoded;
+        if (!PresetFormat::decode(m_library.getPayload(name), size, decoded)) {
+            return nullptr;
+        }
+        pixels = m_pixelCache.insert(entry->contentHash, size, std::move(decoded));
+    }
+
+    setPresetHash(name, entry->contentHash);
+    return pixels;
+}
+
+int FileManager::warmPresetCache() {
+    std::vector<std::string> names = getPresetNames();
+
+    // Pool threads claim presets in list order. Each reserves its preset's
+    // decoded size before decoding it; one that does not fit is skipped, since
+    // inserting it would only evict a preset warmed before it.
+    std::atomic<int> decoded = 0;
+    std::atomic<size_t> reserved = m_pixelCache.getBytes();
+    size_t budget = m_pixelCache.getBudget();
+
+    ThreadPool::getShared().run(names.size(), [&](size_t i) {
+        if (findCachedPreset(names[i])) {
+            decoded++;
+            return;
+        }
+
+        std::shared_lock<std::shared_mutex> lock(m_fileMutex);
+        int size;
+        if (!findPresetSize(names[i], size)) {
+            return;
+        }
+
+        size_t bytes = (size_t)size * size * sizeof(uint32_t);
+        if (reserved.fetch_add(bytes) + bytes > budget) {
+            reserved -= bytes;
+            return;
+        }
+
+        if (decodePreset(names[i])) {
+            decoded++;
+        }
+    });
+
+    return decoded;
+}
+
+bool FileManager::findPresetSize(const std::string& name, int& size) {
+    if (m_library.isOpen()) {
+        const PresetLibrary::Entry* entry = m_library.find(name);
+        if (!entry) {
+            return false;
+        }
+        size = (int)entry->width;
+        return true;
+    }
+
+    MappedFile file;
+    if (!file.open(getPresetPath(name))) {
+        return false;
+    }
+
+    std::string_view data = file.getData();
+    if (PresetFormat::isBinary(data)) {
+        if (data.size() < PresetFormat::V2_HEADER_SIZE) {
+            return false;
+        }
+        const unsigned char* p = (const unsigned char*)data.data() + 8;
+        size = (int)(p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24));
+    }
+    else {
+        // CSV presets start with their size
+        auto [end, error] = std::from_chars(data.data(), data.data() + data.size(), size);
+        if (error != std::errc()) {
+            return false;
+        }
+    }
+
+    return size > 0 && size <= PresetFormat::MAX_SIZE;
+}
 
+void FileManager::invalidatePreset(const std::string& name) {
+    forgetPresetHash(name);
+}
+
+void FileManager::invalidatePresets() {
+    std::lock_guard<std::mutex> lock(m_cacheMutex);
+    m_presetHashes.clear();
+}
+
+bool FileManager::findPresetHash(const std::string& name, uint64_t& hash) {
+    if (findCachedPresetHash(name, hash)) {
+        return true;
+    }
+
+    // Recorded while the file lock is held, so a save cannot slip in between
+    std::shared_lock<std::shared_mutex> lock(m_fileMutex);
+    if (m_library.isOpen()) {
+        const PresetLibrary::Entry* entry = m_library.find(name);
+        if (!entry) {
+            return false;
+        }
+        hash = entry->contentHash;
+    }
+    else {
+        MappedFile file;
+        if (!file.open(getPresetPath(name)) || !PresetFormat::readContentHash(file.getData(), hash)) {
+            return false;
+        }
+    }
+
+    setPresetHash(name, hash);
     return true;
 }
 
-bool FileManager::loadPreset(const std::string& name, Crosshair& crosshair) {
-    std::string filePath = getPresetPath(name);
-    std::ifstream file(filePath);
+bool FileManager::findCachedPresetHash(const std::string& name, uint64_t& hash) {
+    std::lock_guard<std::mutex> lock(m_cacheMutex);
 
-    if (!file.is_open()) {
+    auto it = m_presetHashes.find(name);
+    if (it == m_presetHashes.end()) {
         return false;
     }
 
-    // Read serialized crosshair data
-    std::string data;
-    std::getline(file, data);
+    hash = it->second;
+    return true;
+}
+
+std::shared_ptr<const PresetThumbnail> FileManager::readThumbnail(const std::string& name) {
+    // Decoding the preset records its hash
+    std::shared_ptr<const PixelCache::Pixels> pixels;
+    uint64_t hash;
+    if (!findPresetHash(name, hash)) {
+        pixels = readPreset(name);
+        if (!pixels || !findPresetHash(name, hash)) {
+            return nullptr;
+        }
+    }
+
+    auto thumbnail = std::make_shared<PresetThumbnail>();
+    thumbnail->hash = hash;
+
+    std::string path = getThumbnailPath(hash);
+    MappedFile file;
+    if (file.open(path) && PresetFormat::decode(file.getData(), thumbnail->size, thumbnail->pixels)
+        && thumbnail->size <= ThumbnailAtlas::THUMBNAIL_SIZE) {
+        return thumbnail;
+    }
     file.close();
 
-    return crosshair.deserialize(data);
+    if (!pixels) {
+        pixels = readPreset(name);
+        if (!pixels) {
+            return nullptr;
+        }
+    }
+
+    int size = ThumbnailAtlas::render(pixels->size, pixels->data.data(), thumbnail->pixels);
+    thumbnail->size = size;
+
+    const uint32_t* thumbnailPixels = thumbnail->pixels.data();
+    FileSink::writeAtomic(path, [&](PresetSink& sink) {
+        PresetFormat::encode(size, [&](int y, uint32_t* out) {
+            std::copy_n(thumbnailPixels + (size_t)y * size, size, out);
+        }, sink);
+    });
+
+    return thumbnail;
+}
+
+int FileManager::pruneThumbnails() {
+    std::unordered_set<uint64_t> hashes;
+    for (const std::string& name : getPresetNames()) {
+        uint64_t hash;
+        if (findPresetHash(name, hash) || (readPreset(name) && findPresetHash(name, hash))) {
+            hashes.insert(hash);
+        }
+    }
+
+    // Only files named the way getThumbnailPath names them are touched
+    std::error_code error;
+    std::vector<std::filesystem::path> stale;
+    for (const auto& entry : std::filesystem::directory_iterator(m_thumbnailsPath, error)) {
+        std::string stem = entry.path().stem().string();
+        if (!entry.is_regular_file() || entry.path().extension() != ".thumb" || stem.size() != 16) {
+            continue;
+        }
+
+        uint64_t hash;
+        auto [end, parseError] = std::from_chars(stem.data(), stem.data() + stem.size(), hash, 16);
+        if (parseError == std::errc() && end == stem.data() + stem.size() && !hashes.count(hash)) {
+            stale.push_back(entry.path());
+        }
+    }
+
+    int removed = 0;
+    for (const auto& path : stale) {
+        if (std::filesystem::remove(path, error)) {
+            removed++;
+        }
+    }
+    return removed;
+}
+
+void FileManager::setPresetCacheBudget(size_t bytes) {
+    m_pixelCache.setBudget(bytes);
+}
+
+void FileManager::setPresetHash(const std::string& name, uint64_t hash) {
+    std::lock_guard<std::mutex> lock(m_cacheMutex);
+    m_presetHashes[name] = hash;
+}
+
+void FileManager::forgetPresetHash(const std::string& name) {
+    std::lock_guard<std::mutex> lock(m_cacheMutex);
+    m_presetHashes.erase(name);
 }
 
 bool FileManager::deletePreset(const std::string& name) {
-    std::string filePath = getPresetPath(name);
-    return std::filesystem::remove(filePath);
+    std::lock_guard<std::shared_mutex> lock(m_fileMutex);
+    forgetPresetHash(name);
+
+    // The directory copy goes too, or enabling the library again would
+    // import it back
+    if (m_library.isOpen()) {
+        std::error_code error;
+        std::filesystem::remove(getPresetPath(name), error);
+        return m_library.remove(name);
+    }
+
+    return std::filesystem::remove(getPresetPath(name));
+}
+
+std::vector<std::vector<std::string>> FileManager::findDuplicatePresets() {
+    std::shared_lock<std::shared_mutex> lock(m_fileMutex);
+    std::map<uint64_t, std::vector<std::string>> byHash;
+
+    if (m_library.isOpen()) {
+        // The index already holds every hash
+        for (const std::string& name : m_library.getNames()) {
+            byHash[m_library.find(name)->contentHash].push_back(name);
+        }
+    }
+    else {
+        std::error_code error;
+        for (const auto& entry : std::filesystem::directory_iterator(m_presetsPath, error)) {
+            if (!entry.is_regular_file() || entry.path().extension() != ".crosshair") {
+                continue;
+            }
+
+            MappedFile file;
+            if (!file.open(entry.path().string())) {
+                continue;
+            }
+
+            // Only presets saved without their hash have to be decoded
+            uint64_t hash;
+            Crosshair crosshair;
+            if (PresetFormat::readContentHash(file.getData(), hash)) {
+                byHash[hash].push_back(entry.path().stem().string());
+            }
+            else if (parsePreset(file.getData(), crosshair)) {
+                byHash[crosshair.getContentHash()].push_back(entry.path().stem().string());
+            }
+        }
+    }
+
+    std::vector<std::vector<std::string>> duplicates;
+    for (auto& [hash, names] : byHash) {
+        if (names.size() > 1) {
+            std::sort(names.begin(), names.end());
+            duplicates.push_back(std::move(names));
+        }
+    }
+    return duplicates;
+}
+
+bool FileManager::setLibraryEnabled(bool enabled) {
+    std::lock_guard<std::shared_mutex> lock(m_fileMutex);
+
+    // Names may hold different content in the other store
+    {
+        std::lock_guard<std::mutex> cacheLock(m_cacheMutex);
+        m_presetHashes.clear();
+    }
+
+    if (!enabled) {
+        // Presets saved while the library was on would vanish otherwise
+        if (m_library.isOpen()) {
+            exportPresetLibrary();
+        }
+        m_library.close();
+        return true;
+    }
+
+    if (m_library.isOpen()) {
+        return true;
+    }
+
+    // The directory was the live store until now, so it may hold presets
+    // added or changed since the library was last used
+    if (!m_library.open(m_libraryPath)) {
+        return false;
+    }
+
+    importPresetDirectory();
+    return true;
+}
+
+int FileManager::importPresetDirectory() {
+    std::error_code error;
+    int imported = 0;
+
+    for (const auto& entry : std::filesystem::directory_iterator(m_presetsPath, error)) {
+        if (!entry.is_regular_file() || entry.path().extension() != ".crosshair") {
+            continue;
+        }
+
+        std::string name = entry.path().stem().string();
+
+        MappedFile file;
+        Crosshair crosshair;
+        if (!file.open(entry.path().string()) || !parsePreset(file.getData(), crosshair)) {
+            continue;
+        }
+
+        uint64_t contentHash = crosshair.getContentHash();
+        const PresetLibrary::Entry* existing = m_library.find(name);
+        if (existing && existing->contentHash == contentHash) {
+            continue;
+        }
+
+        // Binary files are already valid payloads
+        bool stored = PresetFormat::isBinary(file.getData())
+            ? m_library.put(name, file.getData(), contentHash)
+            : m_library.put(name, crosshair.serializeBinary(), contentHash);
+        if (stored) {
+            imported++;
+        }
+    }
+
+    return imported;
+}
+
+int FileManager::exportPresetLibrary() {
+    int exported = 0;
+
+    for (const std::string& name : m_library.getNames()) {
+        std::string_view payload = m_library.getPayload(name);
+        if (payload.empty()) {
+            continue;
+        }
+
+        // Payloads are binary presets already; files that match are left alone
+        std::string path = getPresetPath(name);
+        {
+            MappedFile file;
+            if (file.open(path) && file.getData() == payload) {
+                continue;
+            }
+        }
+
+        bool written = FileSink::writeAtomic(path, [&](PresetSink& sink) {
+            sink.write(payload.data(), payload.size());
+        });
+        if (written) {
+            exported++;
+        }
+    }
+
+    return exported;
+}
+
+void FileManager::migratePresetsAsync() {
+    if (m_migrationThread.joinable() || std::filesystem::exists(m_migrationMarkerPath)) {
+        return;
+    }
+
+    m_migrationThread = std::thread(&FileManager::migratePresets, this);
+}
+
+void FileManager::migratePresets() {
+    std::error_code error;
+    std::vector<std::filesystem::path> files;
+
+    for (const auto& entry : std::filesystem::directory_iterator(m_presetsPath, error)) {
+        if (entry.is_regular_file() && entry.path().extension() == ".crosshair") {
+            files.push_back(entry.path());
+        }
+    }
+
+    for (const auto& path : files) {
+        if (m_stopMigration) {
+            return;
+        }
+
+        std::lock_guard<std::shared_mutex> lock(m_fileMutex);
+
+        // Presets that already store their hash are current
+        MappedFile file;
+        uint64_t hash;
+        if (!file.open(path.string()) || PresetFormat::readContentHash(file.getData(), hash)) {
+            continue;
+        }
+
+        // Presets that fail to parse are left as they are. The mapping is
+        // closed first since a mapped file cannot be replaced.
+        Crosshair crosshair;
+        bool parsed = parsePreset(file.getData(), crosshair);
+        file.close();
+
+        if (parsed) {
+            FileSink::writeAtomic(path.string(), [&](PresetSink& sink) {
+                crosshair.serializeBinary(sink);
+            });
+        }
+    }
+
+    std::ofstream marker(m_migrationMarkerPath);
 }
 
 std::vector<std::string> FileManager::getPresetNames() {
+    {
+        std::shared_lock<std::shared_mutex> lock(m_fileMutex);
+        if (m_library.isOpen()) {
+            return m_library.getNames();
+        }
+    }
+
     std::vector<std::string> presets;
 
     for (const auto& entry : std::filesystem::directory_iterator(m_presetsPath)) {
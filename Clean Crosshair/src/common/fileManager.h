@@ -3,8 +3,17 @@
 #include <string>
 #include <vector>
 #include <memory>
+#include <unordered_map>
+#include <thread>
+#include <mutex>
+#include <shared_mutex>
+#include <atomic>
 #include <windows.h>
 #include "../common/crosshair.h"
+#include "../common/presetSink.h"
+#include "../common/presetLibrary.h"
+#include "../common/pixelCache.h"
+#include "../common/thumbnailAtlas.h"
 
 // Represents a saved crosshair preset
 struct CrosshairPreset {
@@ -17,6 +26,13 @@ struct CrosshairPreset {
     }
 };
 
+// Preview of a preset, see ThumbnailAtlas::render
+struct PresetThumbnail {
+    uint64_t hash;  // Content hash of the preset
+    int size;
+    std::vector<uint32_t> pixels;
+};
+
 class FileManager {
 public:
     FileManager();
@@ -25,21 +41,88 @@ public:
     // Get application data directory
     std::string getAppDataDirectory() const;
 
+    // This application's folder inside it, and the preset folder inside that
+    const std::string& getDataPath() const { return m_appDataPath; }
+    const std::string& getPresetsPath() const { return m_presetsPath; }
+
+    // Edit journal, kept in its own folder so its constant appends do not
+    // reach watchers of the data folder
+    const std::string& getJournalPath() const { return m_journalPath; }
+
     // Create directories if they don't exist
     bool initializeDirectories();
 
-    // Save a crosshair preset
+    // Save a crosshair preset (binary format, see presetFormat.h)
     bool savePreset(const std::string& name, const Crosshair& crosshair);
 
-    // Load a crosshair preset
+    // Load a crosshair preset, accepting both the binary and the old CSV format
     bool loadPreset(const std::string& name, Crosshair& crosshair);
 
+    // Decode a preset without touching any crosshair, for loading off the UI
+    // thread; null if it is missing or malformed. Decoded presets stay in the
+    // pixel cache until it runs out of budget.
+    std::shared_ptr<const PixelCache::Pixels> readPreset(const std::string& name);
+
+    // Decoded pixels of a preset if it is cached, else null. Never touches the
+    // disk or waits for other preset I/O, so the UI thread can switch presets
+    // with it directly.
+    std::shared_ptr<const PixelCache::Pixels> findCachedPreset(const std::string& name);
+
+    // Decode every preset into the cache on the shared thread pool. Presets
+    // that would not fit in what is left of the budget are skipped, so nothing
+    // warmed is evicted again. Each preset takes the file lock on its own, so
+    // saves and loads are not held up until the whole library is done. Returns
+    // how many are cached.
+    int warmPresetCache();
+
+    // Forget what is cached for a preset whose file changed behind our back
+    void invalidatePreset(const std::string& name);
+
+    // Same for every preset, when it is not known which files changed
+    void invalidatePresets();
+
+    // Content hash of a preset: recorded when it was decoded, else read from
+    // the library index or the preset file's header. False for presets saved
+    // without one (CSV and version 2) until they are decoded.
+    bool findPresetHash(const std::string& name, uint64_t& hash);
+
+    // Same, but only a hash already recorded, without touching the disk
+    bool findCachedPresetHash(const std::string& name, uint64_t& hash);
+
+    // Thumbnail of a preset, rendered once per content hash and kept in the
+    // thumbnail directory afterwards. Null if the preset cannot be read.
+    std::shared_ptr<const PresetThumbnail> readThumbnail(const std::string& name);
+
+    // Delete stored thumbnails whose content no preset has any more, returning
+    // how many went. Presets saved without their hash are decoded to find it.
+    int pruneThumbnails();
+
+    // Memory the decoded presets may use, in bytes
+    void setPresetCacheBudget(size_t bytes);
+    size_t getPresetCacheBytes() const { return m_pixelCache.getBytes(); }
+
     // Delete a crosshair preset
     bool deletePreset(const std::string& name);
 
     // Get list of all available presets
     std::vector<std::string> getPresetNames();
 
+    // Keep presets in a single library file (see presetLibrary.h) instead of
+    // one file each. Enabling the library imports directory presets it does
+    // not have or holds different content for; disabling it exports every
+    // library preset back to the directory, which is then used again.
+    bool setLibraryEnabled(bool enabled);
+    bool isLibraryEnabled() const { return m_library.isOpen(); }
+
+    // Groups of presets with identical pixels (see Crosshair::getContentHash),
+    // each sorted by name. With the library enabled only its index is read.
+    std::vector<std::vector<std::string>> findDuplicatePresets();
+
+    // Rewrite CSV and version 2 presets in the current binary format, which
+    // stores their content hash, on a background thread. Runs until it
+    // completes once; a marker file in the app data directory records that
+    void migratePresetsAsync();
+
     // Load application settings
     bool loadSettings();
 
@@ -50,7 +133,59 @@ private:
     std::string m_appDataPath;
     std::string m_presetsPath;
     std::string m_settingsPath;
+    std::string m_migrationMarkerPath;
+    std::string m_libraryPath;
+    std::string m_thumbnailsPath;
+    std::string m_journalPath;
+
+    // Open while the library is enabled
+    PresetLibrary m_library;
+
+    // Decoded presets shared by content hash
+    PixelCache m_pixelCache;
+
+    // Content hash of every preset decoded so far, so a cached preset is found
+    // by name. Guarded by m_cacheMutex rather than m_fileMutex, so lookups
+    // never wait behind I/O.
+    std::unordered_map<std::string, uint64_t> m_presetHashes;
+    std::mutex m_cacheMutex;
+
+    // Background migration; preset access holds m_fileMutex so a save never
+    // races the migration of the same file. Reads share it, writes hold it
+    // alone.
+    std::thread m_migrationThread;
+    std::atomic<bool> m_stopMigration;
+    std::shared_mutex m_fileMutex;
 
     // Get preset file path from name
     std::string getPresetPath(const std::string& name) const;
+
+    // Thumbnails are stored by content hash, in the binary preset format
+    std::string getThumbnailPath(uint64_t hash) const;
+
+    // Convert every CSV preset, then write the marker file
+    void migratePresets();
+
+    // Decode a preset through the pixel cache. Called with m_fileMutex held,
+    // shared or not.
+    std::shared_ptr<const PixelCache::Pixels> decodePreset(const std::string& name);
+    std::shared_ptr<const PixelCache::Pixels> readLibraryPreset(const std::string& name);
+
+    // Grid size of a preset from its index entry or header, without decoding
+    // it. Called with m_fileMutex held.
+    bool findPresetSize(const std::string& name, int& size);
+
+    // Remember or forget which content a preset name holds
+    void setPresetHash(const std::string& name, uint64_t hash);
+    void forgetPresetHash(const std::string& name);
+
+    // Copy directory presets missing from the library, or different from its
+    // copy, into it, returning how many were stored. Library presets missing
+    // from the directory are kept. Called with m_fileMutex held.
+    int importPresetDirectory();
+
+    // Write every library preset whose directory file is missing or differs
+    // to the directory, returning how many were written. Called with
+    // m_fileMutex held.
+    int exportPresetLibrary();
 };
\ No newline at end of file
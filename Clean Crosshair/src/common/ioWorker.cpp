@@ -0,0 +1,81 @@
+#include "ioWorker.h"
+#include <algorithm>
+
+IoWorker::IoWorker()
+    : m_busy(false),
+    m_stop(false) {
+    m_thread = std::thread(&IoWorker::run, this);
+}
+
+IoWorker::~IoWorker() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_wake.notify_one();
+    m_thread.join();
+}
+
+void IoWorker::poll() {
+    std::vector<Completion> completions;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        completions.swap(m_completions);
+    }
+
+    for (Completion& completion : completions) {
+        completion();
+    }
+}
+
+void IoWorker::wait() {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_idle.wait(lock, [this] { return m_jobs.empty() && !m_busy; });
+}
+
+size_t IoWorker::getPendingCount() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_jobs.size() + (m_busy ? 1 : 0);
+}
+
+void IoWorker::enqueue(const std::string& key, std::function<Completion()> run) {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        // The replacement goes to the back so it still runs after everything
+        // submitted before it
+        if (!key.empty()) {
+            m_jobs.erase(std::remove_if(m_jobs.begin(), m_jobs.end(),
+                [&](const Job& job) { return job.key == key; }), m_jobs.end());
+        }
+
+        m_jobs.push_back({ key, std::move(run) });
+    }
+    m_wake.notify_one();
+}
+
+void IoWorker::run() {
+    std::unique_lock<std::mutex> lock(m_mutex);
+
+    while (true) {
+        m_wake.wait(lock, [this] { return m_stop || !m_jobs.empty(); });
+        if (m_jobs.empty()) {
+            return;
+        }
+
+        Job job = std::move(m_jobs.front());
+        m_jobs.pop_front();
+        m_busy = true;
+
+        lock.unlock();
+        Completion completion = job.run();
+        lock.lock();
+
+        m_completions.push_back(std::move(completion));
+        m_busy = false;
+
+        if (m_jobs.empty()) {
+            m_idle.notify_all();
+        }
+    }
+}
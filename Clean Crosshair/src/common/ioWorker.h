@@ -0,0 +1,68 @@
+#pragma once
+
+#include <string>
+#include <deque>
+#include <vector>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+// Runs file I/O on a background thread so the UI never waits on the disk.
+// Jobs run one at a time in submission order; each job's completion then runs
+// on whichever thread calls poll(), normally the UI thread once per frame.
+// Submitting a job with the same non-empty key as one still queued replaces
+// that job, which is dropped along with its completion.
+class IoWorker {
+public:
+    IoWorker();
+
+    // Finishes every queued job before returning; completions that were never
+    // polled are dropped
+    ~IoWorker();
+
+    IoWorker(const IoWorker&) = delete;
+    IoWorker& operator=(const IoWorker&) = delete;
+
+    // Run work() on the worker thread, then done(result) from poll()
+    template <typename Work, typename Done>
+    void submit(const std::string& key, Work work, Done done) {
+        enqueue(key, [work = std::move(work), done = std::move(done)]() mutable -> Completion {
+            auto result = work();
+            return [done = std::move(done), result = std::move(result)]() mutable {
+                done(std::move(result));
+            };
+        });
+    }
+
+    // Run the completions of finished jobs on the calling thread
+    void poll();
+
+    // Block until every queued job has run
+    void wait();
+
+    // Jobs queued or running
+    size_t getPendingCount() const;
+
+private:
+    using Completion = std::function<void()>;
+
+    struct Job {
+        std::string key;
+        std::function<Completion()> run;
+    };
+
+    std::thread m_thread;
+    mutable std::mutex m_mutex;
+    std::condition_variable m_wake;
+    std::condition_variable m_idle;
+    std::deque<Job> m_jobs;
+    std::vector<Completion> m_completions;
+    bool m_busy;
+    bool m_stop;
+
+    void enqueue(const std::string& key, std::function<Completion()> run);
+
+    // Worker thread loop
+    void run();
+};
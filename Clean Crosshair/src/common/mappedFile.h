@@ -0,0 +1,33 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <cstddef>
+
+// Read-only memory mapping of a whole file (MapViewOfFile on Windows, mmap
+// elsewhere). The view stays valid until the mapping is closed or destroyed.
+class MappedFile {
+public:
+    MappedFile();
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    // Map a file, replacing any previous mapping. Empty files open with an
+    // empty view.
+    bool open(const std::string& path);
+
+    // Unmap the file
+    void close();
+
+    bool isOpen() const { return m_open; }
+
+    // Contents of the file
+    std::string_view getData() const { return std::string_view(m_data, m_size); }
+
+private:
+    const char* m_data;
+    size_t m_size;
+    bool m_open;
+};
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstdint>
+
+// Pixels are stored packed into 32 bits as 0xAABBGGRR, the same layout as
+// ImU32 (IM_COL32), so they can be handed to ImGui and D3D without repacking.
+// Fully transparent pixels are always stored as 0.
+constexpr uint8_t packedAlpha(uint32_t packed) { return (uint8_t)(packed >> 24); }
+
+// RGBA color representation
+struct Color {
+    uint8_t r, g, b, a;
+
+    constexpr Color() : r(0), g(0), b(0), a(0) {}
+    constexpr Color(uint8_t r, uint8_t g, uint8_t b, uint8_t a = 255) : r(r), g(g), b(b), a(a) {}
+
+    // Convert color to uint32_t representation (for ImGui)
+    constexpr uint32_t toImU32() const {
+        return (uint32_t)r | ((uint32_t)g << 8) | ((uint32_t)b << 16) | ((uint32_t)a << 24);
+    }
+
+    // Convert back from the packed representation
+    static constexpr Color fromImU32(uint32_t packed) {
+        return Color((uint8_t)packed, (uint8_t)(packed >> 8), (uint8_t)(packed >> 16), (uint8_t)(packed >> 24));
+    }
+
+    constexpr bool operator==(const Color& other) const {
+        return r == other.r && g == other.g && b == other.b && a == other.a;
+    }
+    constexpr bool operator!=(const Color& other) const { return !(*this == other); }
+};
+
+// Integer rectangle in grid coordinates (max is exclusive)
+struct PixelRect {
+    int minX, minY, maxX, maxY;
+
+    PixelRect() : minX(0), minY(0), maxX(0), maxY(0) {}
+    PixelRect(int minX, int minY, int maxX, int maxY) : minX(minX), minY(minY), maxX(maxX), maxY(maxY) {}
+
+    bool isEmpty() const { return maxX <= minX || maxY <= minY; }
+    int width() const { return maxX - minX; }
+    int height() const { return maxY - minY; }
+
+    // Grow to contain the given pixel
+    void include(int x, int y);
+
+    // Grow to contain another rectangle
+    void include(const PixelRect& other);
+};
\ No newline at end of file
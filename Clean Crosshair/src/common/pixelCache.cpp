@@ -0,0 +1,76 @@
+#include "pixelCache.h"
+
+PixelCache::PixelCache(size_t budget)
+    : m_budget(budget),
+    m_bytes(0) {
+}
+
+std::shared_ptr<const PixelCache::Pixels> PixelCache::find(uint64_t hash) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    auto it = m_lookup.find(hash);
+    if (it == m_lookup.end()) {
+        return nullptr;
+    }
+
+    m_entries.splice(m_entries.begin(), m_entries, it->second);
+    return it->second->pixels;
+}
+
+std::shared_ptr<const PixelCache::Pixels> PixelCache::insert(uint64_t hash, int size, std::vector<uint32_t> pixels) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    auto it = m_lookup.find(hash);
+    if (it != m_lookup.end()) {
+        m_entries.splice(m_entries.begin(), m_entries, it->second);
+        return it->second->pixels;
+    }
+
+    auto shared = std::make_shared<const Pixels>(Pixels{ size, std::move(pixels) });
+    m_entries.push_front({ hash, shared });
+    m_lookup[hash] = m_entries.begin();
+    m_bytes += shared->data.size() * sizeof(uint32_t);
+
+    trim();
+    return shared;
+}
+
+void PixelCache::trim() {
+    // The newest entry is kept even if it alone exceeds the budget
+    while (m_bytes > m_budget && m_entries.size() > 1) {
+        const Entry& oldest = m_entries.back();
+        m_bytes -= oldest.pixels->data.size() * sizeof(uint32_t);
+        m_lookup.erase(oldest.hash);
+        m_entries.pop_back();
+    }
+}
+
+void PixelCache::clear() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    m_entries.clear();
+    m_lookup.clear();
+    m_bytes = 0;
+}
+
+void PixelCache::setBudget(size_t budget) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    m_budget = budget;
+    trim();
+}
+
+size_t PixelCache::getBudget() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_budget;
+}
+
+size_t PixelCache::getCount() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_entries.size();
+}
+
+size_t PixelCache::getBytes() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_bytes;
+}
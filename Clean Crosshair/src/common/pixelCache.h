@@ -0,0 +1,59 @@
+#pragma once
+
+#include <vector>
+#include <list>
+#include <unordered_map>
+#include <memory>
+#include <mutex>
+#include <cstdint>
+#include <cstddef>
+
+// Decoded preset pixels keyed by content hash (see contentHash.h), so presets
+// with identical pixels share one buffer whatever they are named. The least
+// recently used buffers are dropped once the cache is over its byte budget;
+// buffers still referenced elsewhere stay alive until released.
+// Safe to use from several threads.
+class PixelCache {
+public:
+    static constexpr size_t DEFAULT_BUDGET = 64 * 1024 * 1024;
+
+    struct Pixels {
+        int size;
+        std::vector<uint32_t> data;  // size * size packed pixels
+    };
+
+    explicit PixelCache(size_t budget = DEFAULT_BUDGET);
+
+    // Buffer cached for a content hash, or null
+    std::shared_ptr<const Pixels> find(uint64_t hash);
+
+    // Cache decoded pixels under a content hash. If the hash is already cached
+    // the existing buffer is returned and pixels is dropped.
+    std::shared_ptr<const Pixels> insert(uint64_t hash, int size, std::vector<uint32_t> pixels);
+
+    void clear();
+
+    // Change the byte budget, dropping buffers until the cache fits
+    void setBudget(size_t budget);
+    size_t getBudget() const;
+
+    size_t getCount() const;
+    size_t getBytes() const;
+
+private:
+    struct Entry {
+        uint64_t hash;
+        std::shared_ptr<const Pixels> pixels;
+    };
+
+    size_t m_budget;
+    size_t m_bytes;
+
+    // Most recently used first
+    std::list<Entry> m_entries;
+    std::unordered_map<uint64_t, std::list<Entry>::iterator> m_lookup;
+    mutable std::mutex m_mutex;
+
+    // Drop the oldest buffers while over budget. Called with m_mutex held.
+    void trim();
+};
@@ -0,0 +1,373 @@
+#include "pixelKernels.h"
+#include <algorithm>
+#include <bit>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define PIXEL_KERNELS_X86 1
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+// MSVC accepts any intrinsic anywhere; GCC and Clang need the target enabled per function
+#if defined(__GNUC__) || defined(__clang__)
+#define TARGET_SSE2 __attribute__((target("sse2")))
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define TARGET_SSE2
+#define TARGET_AVX2
+#endif
+
+// ---------------------------------------------------------------------------
+// Scalar reference
+
+static int fillRowScalar(uint32_t* dst, int count, uint32_t color) {
+    int changed = 0;
+    for (int i = 0; i < count; i++) {
+        changed += dst[i] != color;
+        dst[i] = color;
+    }
+    return changed;
+}
+
+// Every table uses this one; the library memcpy behind it is never slower
+// than a plain vector loop (see tests/pixelKernelsTest.cpp)
+static void copyRowScalar(uint32_t* dst, const uint32_t* src, int count) {
+    std::copy_n(src, count, dst);
+}
+
+static int scanAlphaScalar(const uint32_t* src, int count, uint64_t* bits) {
+    int covered = 0;
+    for (int w = 0; w * 64 < count; w++) {
+        int n = std::min(count - w * 64, 64);
+        uint64_t word = 0;
+        for (int i = 0; i < n; i++) {
+            if ((src[w * 64 + i] >> 24) != 0) {
+                word |= 1ull << i;
+            }
+        }
+        bits[w] = word;
+        covered += std::popcount(word);
+    }
+    return covered;
+}
+
+static void clearTransparentScalar(uint32_t* dst, int count) {
+    for (int i = 0; i < count; i++) {
+        if ((dst[i] >> 24) == 0) {
+            dst[i] = 0;
+        }
+    }
+}
+
+static int replaceColorScalar(uint32_t* dst, int count, uint32_t from, uint32_t to) {
+    int replaced = 0;
+    for (int i = 0; i < count; i++) {
+        if (dst[i] == from) {
+            dst[i] = to;
+            replaced++;
+        }
+    }
+    return replaced;
+}
+
+static void multiplyAlphaScalar(uint32_t* dst, int count, uint8_t factor) {
+    for (int i = 0; i < count; i++) {
+        uint32_t alpha = scaleAlpha((uint8_t)(dst[i] >> 24), factor);
+        dst[i] = alpha != 0 ? (dst[i] & 0x00FFFFFF) | (alpha << 24) : 0;
+    }
+}
+
+static const PixelKernels s_scalarKernels = {
+    PixelKernelLevel::Scalar,
+    fillRowScalar,
+    copyRowScalar,
+    scanAlphaScalar,
+    clearTransparentScalar,
+    replaceColorScalar,
+    multiplyAlphaScalar
+};
+
+#ifdef PIXEL_KERNELS_X86
+
+// ---------------------------------------------------------------------------
+// SSE2: 4 pixels per step, remainder handled by the scalar code
+
+// Comparison results (-1 per matching lane) are summed in registers and only
+// reduced once per call; a per-step popcount is not available on every SSE2 CPU
+TARGET_SSE2 static int sumLanesSSE2(__m128i v) {
+    v = _mm_add_epi32(v, _mm_shuffle_epi32(v, _MM_SHUFFLE(1, 0, 3, 2)));
+    v = _mm_add_epi32(v, _mm_shuffle_epi32(v, _MM_SHUFFLE(2, 3, 0, 1)));
+    return _mm_cvtsi128_si32(v);
+}
+
+TARGET_SSE2 static int fillRowSSE2(uint32_t* dst, int count, uint32_t color) {
+    __m128i value = _mm_set1_epi32((int)color);
+    __m128i same = _mm_setzero_si128();
+    int i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m128i* p = (__m128i*)(dst + i);
+        same = _mm_sub_epi32(same, _mm_cmpeq_epi32(_mm_loadu_si128(p), value));
+        _mm_storeu_si128(p, value);
+    }
+    return i - sumLanesSSE2(same) + fillRowScalar(dst + i, count - i, color);
+}
+
+TARGET_SSE2 static int scanAlphaSSE2(const uint32_t* src, int count, uint64_t* bits) {
+    __m128i alphaMask = _mm_set1_epi32((int)0xFF000000);
+    __m128i zero = _mm_setzero_si128();
+    int covered = 0;
+    for (int w = 0; w * 64 < count; w++) {
+        const uint32_t* row = src + w * 64;
+        int n = std::min(count - w * 64, 64);
+        uint64_t word = 0;
+        int i = 0;
+        for (; i + 4 <= n; i += 4) {
+            __m128i transparent = _mm_cmpeq_epi32(_mm_and_si128(_mm_loadu_si128((const __m128i*)(row + i)), alphaMask), zero);
+            word |= (uint64_t)(~_mm_movemask_ps(_mm_castsi128_ps(transparent)) & 0xF) << i;
+        }
+        for (; i < n; i++) {
+            if ((row[i] >> 24) != 0) {
+                word |= 1ull << i;
+            }
+        }
+        bits[w] = word;
+        covered += std::popcount(word);
+    }
+    return covered;
+}
+
+TARGET_SSE2 static void clearTransparentSSE2(uint32_t* dst, int count) {
+    __m128i alphaMask = _mm_set1_epi32((int)0xFF000000);
+    __m128i zero = _mm_setzero_si128();
+    int i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m128i* p = (__m128i*)(dst + i);
+        __m128i v = _mm_loadu_si128(p);
+        __m128i transparent = _mm_cmpeq_epi32(_mm_and_si128(v, alphaMask), zero);
+        _mm_storeu_si128(p, _mm_andnot_si128(transparent, v));
+    }
+    clearTransparentScalar(dst + i, count - i);
+}
+
+TARGET_SSE2 static int replaceColorSSE2(uint32_t* dst, int count, uint32_t from, uint32_t to) {
+    __m128i fromValue = _mm_set1_epi32((int)from);
+    __m128i toValue = _mm_set1_epi32((int)to);
+    __m128i replaced = _mm_setzero_si128();
+    int i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m128i* p = (__m128i*)(dst + i);
+        __m128i v = _mm_loadu_si128(p);
+        __m128i match = _mm_cmpeq_epi32(v, fromValue);
+        replaced = _mm_sub_epi32(replaced, match);
+        _mm_storeu_si128(p, _mm_or_si128(_mm_and_si128(match, toValue), _mm_andnot_si128(match, v)));
+    }
+    return sumLanesSSE2(replaced) + replaceColorScalar(dst + i, count - i, from, to);
+}
+
+TARGET_SSE2 static void multiplyAlphaSSE2(uint32_t* dst, int count, uint8_t factor) {
+    __m128i scale = _mm_set1_epi32(factor);
+    __m128i round = _mm_set1_epi32(128);
+    __m128i rgbMask = _mm_set1_epi32(0x00FFFFFF);
+    __m128i zero = _mm_setzero_si128();
+    int i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m128i* p = (__m128i*)(dst + i);
+        __m128i v = _mm_loadu_si128(p);
+
+        // alpha * factor fits in the low 16 bits of each lane
+        __m128i x = _mm_add_epi32(_mm_mullo_epi16(_mm_srli_epi32(v, 24), scale), round);
+        __m128i alpha = _mm_srli_epi32(_mm_add_epi32(x, _mm_srli_epi32(x, 8)), 8);
+
+        __m128i transparent = _mm_cmpeq_epi32(alpha, zero);
+        v = _mm_or_si128(_mm_and_si128(v, rgbMask), _mm_slli_epi32(alpha, 24));
+        _mm_storeu_si128(p, _mm_andnot_si128(transparent, v));
+    }
+    multiplyAlphaScalar(dst + i, count - i, factor);
+}
+
+static const PixelKernels s_sse2Kernels = {
+    PixelKernelLevel::SSE2,
+    fillRowSSE2,
+    copyRowScalar,
+    scanAlphaSSE2,
+    clearTransparentSSE2,
+    replaceColorSSE2,
+    multiplyAlphaSSE2
+};
+
+// ---------------------------------------------------------------------------
+// AVX2: 8 pixels per step, remainder handled by the scalar code
+
+TARGET_AVX2 static int sumLanesAVX2(__m256i v) {
+    __m128i half = _mm_add_epi32(_mm256_castsi256_si128(v), _mm256_extracti128_si256(v, 1));
+    half = _mm_add_epi32(half, _mm_shuffle_epi32(half, _MM_SHUFFLE(1, 0, 3, 2)));
+    half = _mm_add_epi32(half, _mm_shuffle_epi32(half, _MM_SHUFFLE(2, 3, 0, 1)));
+    return _mm_cvtsi128_si32(half);
+}
+
+TARGET_AVX2 static int fillRowAVX2(uint32_t* dst, int count, uint32_t color) {
+    __m256i value = _mm256_set1_epi32((int)color);
+    __m256i same = _mm256_setzero_si256();
+    int i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m256i* p = (__m256i*)(dst + i);
+        same = _mm256_sub_epi32(same, _mm256_cmpeq_epi32(_mm256_loadu_si256(p), value));
+        _mm256_storeu_si256(p, value);
+    }
+    return i - sumLanesAVX2(same) + fillRowScalar(dst + i, count - i, color);
+}
+
+TARGET_AVX2 static int scanAlphaAVX2(const uint32_t* src, int count, uint64_t* bits) {
+    __m256i alphaMask = _mm256_set1_epi32((int)0xFF000000);
+    __m256i zero = _mm256_setzero_si256();
+    int covered = 0;
+    for (int w = 0; w * 64 < count; w++) {
+        const uint32_t* row = src + w * 64;
+        int n = std::min(count - w * 64, 64);
+        uint64_t word = 0;
+        int i = 0;
+        for (; i + 8 <= n; i += 8) {
+            __m256i transparent = _mm256_cmpeq_epi32(_mm256_and_si256(_mm256_loadu_si256((const __m256i*)(row + i)), alphaMask), zero);
+            word |= (uint64_t)(~_mm256_movemask_ps(_mm256_castsi256_ps(transparent)) & 0xFF) << i;
+        }
+        for (; i < n; i++) {
+            if ((row[i] >> 24) != 0) {
+                word |= 1ull << i;
+            }
+        }
+        bits[w] = word;
+        covered += std::popcount(word);
+    }
+    return covered;
+}
+
+TARGET_AVX2 static void clearTransparentAVX2(uint32_t* dst, int count) {
+    __m256i alphaMask = _mm256_set1_epi32((int)0xFF000000);
+    __m256i zero = _mm256_setzero_si256();
+    int i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m256i* p = (__m256i*)(dst + i);
+        __m256i v = _mm256_loadu_si256(p);
+        __m256i transparent = _mm256_cmpeq_epi32(_mm256_and_si256(v, alphaMask), zero);
+        _mm256_storeu_si256(p, _mm256_andnot_si256(transparent, v));
+    }
+    clearTransparentScalar(dst + i, count - i);
+}
+
+TARGET_AVX2 static int replaceColorAVX2(uint32_t* dst, int count, uint32_t from, uint32_t to) {
+    __m256i fromValue = _mm256_set1_epi32((int)from);
+    __m256i toValue = _mm256_set1_epi32((int)to);
+    __m256i replaced = _mm256_setzero_si256();
+    int i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m256i* p = (__m256i*)(dst + i);
+        __m256i v = _mm256_loadu_si256(p);
+        __m256i match = _mm256_cmpeq_epi32(v, fromValue);
+        replaced = _mm256_sub_epi32(replaced, match);
+        _mm256_storeu_si256(p, _mm256_blendv_epi8(v, toValue, match));
+    }
+    return sumLanesAVX2(replaced) + replaceColorScalar(dst + i, count - i, from, to);
+}
+
+TARGET_AVX2 static void multiplyAlphaAVX2(uint32_t* dst, int count, uint8_t factor) {
+    __m256i scale = _mm256_set1_epi32(factor);
+    __m256i round = _mm256_set1_epi32(128);
+    __m256i rgbMask = _mm256_set1_epi32(0x00FFFFFF);
+    __m256i zero = _mm256_setzero_si256();
+    int i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m256i* p = (__m256i*)(dst + i);
+        __m256i v = _mm256_loadu_si256(p);
+
+        // alpha * factor fits in the low 16 bits of each lane
+        __m256i x = _mm256_add_epi32(_mm256_mullo_epi16(_mm256_srli_epi32(v, 24), scale), round);
+        __m256i alpha = _mm256_srli_epi32(_mm256_add_epi32(x, _mm256_srli_epi32(x, 8)), 8);
+
+        __m256i transparent = _mm256_cmpeq_epi32(alpha, zero);
+        v = _mm256_or_si256(_mm256_and_si256(v, rgbMask), _mm256_slli_epi32(alpha, 24));
+        _mm256_storeu_si256(p, _mm256_andnot_si256(transparent, v));
+    }
+    multiplyAlphaScalar(dst + i, count - i, factor);
+}
+
+static const PixelKernels s_avx2Kernels = {
+    PixelKernelLevel::AVX2,
+    fillRowAVX2,
+    copyRowScalar,
+    scanAlphaAVX2,
+    clearTransparentAVX2,
+    replaceColorAVX2,
+    multiplyAlphaAVX2
+};
+
+// ---------------------------------------------------------------------------
+// CPU detection
+
+static bool detectSSE2() {
+#if defined(_M_X64) || defined(__x86_64__)
+    return true;
+#elif defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 1);
+    return (info[3] & (1 << 26)) != 0;
+#else
+    return __builtin_cpu_supports("sse2");
+#endif
+}
+
+static bool detectAVX2() {
+#ifdef _MSC_VER
+    int info[4];
+    __cpuid(info, 0);
+    if (info[0] < 7) return false;
+
+    // AVX2 also needs the OS to save the YMM registers (OSXSAVE + XCR0)
+    __cpuid(info, 1);
+    bool osxsave = (info[2] & (1 << 27)) != 0;
+    bool avx = (info[2] & (1 << 28)) != 0;
+    if (!osxsave || !avx || (_xgetbv(0) & 0x6) != 0x6) return false;
+
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) != 0;
+#else
+    return __builtin_cpu_supports("avx2");
+#endif
+}
+
+#endif
+
+bool PixelKernels::isSupported(PixelKernelLevel level) {
+#ifdef PIXEL_KERNELS_X86
+    static const bool sse2 = detectSSE2();
+    static const bool avx2 = sse2 && detectAVX2();
+
+    switch (level) {
+    case PixelKernelLevel::SSE2:
+        return sse2;
+    case PixelKernelLevel::AVX2:
+        return avx2;
+    default:
+        return true;
+    }
+#else
+    return level == PixelKernelLevel::Scalar;
+#endif
+}
+
+const PixelKernels& PixelKernels::get(PixelKernelLevel level) {
+#ifdef PIXEL_KERNELS_X86
+    if (isSupported(level)) {
+        if (level == PixelKernelLevel::AVX2) return s_avx2Kernels;
+        if (level == PixelKernelLevel::SSE2) return s_sse2Kernels;
+    }
+#endif
+    return s_scalarKernels;
+}
+
+const PixelKernels& PixelKernels::get() {
+    static const PixelKernels& kernels = isSupported(PixelKernelLevel::AVX2) ? get(PixelKernelLevel::AVX2)
+        : get(PixelKernelLevel::SSE2);
+    return kernels;
+}
\ No newline at end of file
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cstdint>
+
+// Instruction set used by a PixelKernels table
+enum class PixelKernelLevel {
+    Scalar,
+    SSE2,
+    AVX2
+};
+
+// Bulk operations on rows of packed pixels (0xAABBGGRR, see pixel.h). One table per instruction set; get()
+// returns the widest one the CPU supports, picked once on first use. All tables
+// produce identical results, the scalar one being the reference.
+struct PixelKernels {
+    PixelKernelLevel level;
+
+    // Set count pixels to color, returning how many of them changed
+    int (*fillRow)(uint32_t* dst, int count, uint32_t color);
+
+    // Copy count pixels
+    void (*copyRow)(uint32_t* dst, const uint32_t* src, int count);
+
+    // Write one bit per pixel (LSB first, 64 per word) that is set when the
+    // pixel's alpha is non-zero. Writes (count + 63) / 64 words, unused high bits
+    // cleared, and returns the number of bits set
+    int (*scanAlpha)(const uint32_t* src, int count, uint64_t* bits);
+
+    // Turn every pixel with zero alpha into 0
+    void (*clearTransparent)(uint32_t* dst, int count);
+
+    // Replace every pixel equal to from with to, returning how many were replaced
+    int (*replaceColor)(uint32_t* dst, int count, uint32_t from, uint32_t to);
+
+    // Scale alpha by factor / 255 (rounded); pixels reaching zero alpha become 0
+    void (*multiplyAlpha)(uint32_t* dst, int count, uint8_t factor);
+
+    // Fastest table supported by this CPU
+    static const PixelKernels& get();
+
+    // Table for a specific level (falls back to scalar if unsupported)
+    static const PixelKernels& get(PixelKernelLevel level);
+
+    // Whether the CPU can run the given level
+    static bool isSupported(PixelKernelLevel level);
+};
+
+// Alpha scaled by factor / 255, rounded to nearest
+inline uint8_t scaleAlpha(uint8_t alpha, uint8_t factor) {
+    int x = alpha * factor + 128;
+    return (uint8_t)((x + (x >> 8)) >> 8);
+}
\ No newline at end of file
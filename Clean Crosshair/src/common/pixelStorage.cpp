@@ -0,0 +1,757 @@
+#include "pixelStorage.h"
+#include "pixelKernels.h"
+#include <algorithm>
+
+// Same color with another alpha; zero alpha gives the transparent 0
+static uint32_t withAlpha(uint32_t color, uint8_t alpha) {
+    return alpha != 0 ? (color & 0x00FFFFFF) | ((uint32_t)alpha << 24) : 0;
+}
+
+// Bits [lo, hi) of a mask word (0 <= lo < hi <= 64)
+static uint64_t spanBits(int lo, int hi) {
+    return (hi == 64 ? ~0ull : (1ull << hi) - 1) & ~((1ull << lo) - 1);
+}
+
+// Apply op(word, bits) to the coverage bits of a clipped rectangle and sum the
+// results. Instantiated per mask type, so fixed sizes get a constant row stride
+// and whole-row rectangles of 64-pixel multiples become one flat loop.
+template <typename Mask, typename Op>
+static int forEachMaskWord(Mask& mask, const PixelRect& rect, Op op) {
+    int total = 0;
+
+    if (rect.minX == 0 && rect.maxX == mask.size() && mask.size() % 64 == 0) {
+        auto* words = mask.row(rect.minY);
+        int count = (rect.maxY - rect.minY) * mask.wordsPerRow();
+        for (int i = 0; i < count; i++) {
+            total += op(words[i], ~0ull);
+        }
+        return total;
+    }
+
+    int firstWord = rect.minX >> 6, lastWord = (rect.maxX - 1) >> 6;
+    for (int y = rect.minY; y < rect.maxY; y++) {
+        auto* row = mask.row(y);
+        for (int w = firstWord; w <= lastWord; w++) {
+            total += op(row[w], spanBits(std::max(rect.minX - w * 64, 0), std::min(rect.maxX - w * 64, 64)));
+        }
+    }
+    return total;
+}
+
+PixelStorage::PixelStorage() {
+    reset(0);
+}
+
+PixelStorage::PixelStorage(int size) {
+    reset(size);
+}
+
+void PixelStorage::reset(int size) {
+    m_size = size;
+    m_coveredCount = 0;
+    m_format = PixelFormat::Mask;
+
+    m_mask.reset(size);
+    m_maskColor = 0;
+    m_tilesPerRow = (size + TILE_SIZE - 1) / TILE_SIZE;
+    m_lastPaletteIndex = 0;
+
+    // Release the wider representations
+    std::vector<uint32_t>().swap(m_palette);
+    std::vector<uint8_t>().swap(m_indices);
+    std::vector<uint32_t>().swap(m_colors);
+    std::vector<std::unique_ptr<Tile>>().swap(m_tiles);
+}
+
+void PixelStorage::assign(int size, std::span<const uint32_t> pixels) {
+    reset(size);
+
+    // Writes widen the format only as far as the content needs
+    for (int y = 0; y < size; y++) {
+        writeRow(y, 0, size, &pixels[(size_t)y * size]);
+    }
+}
+
+void PixelStorage::resize(int newSize) {
+    PixelStorage resized(newSize);
+
+    int keep = std::min(m_size, newSize);
+    if (m_format == PixelFormat::Mask) {
+        // A single color: copy the runs as rectangles
+        for (int y = 0; y < keep; y++) {
+            forEachSpan(y, [&](int startX, int endX) {
+                resized.fillRect(PixelRect(startX, y, std::min(endX, keep), y + 1), m_maskColor);
+            });
+        }
+    }
+    else {
+        std::vector<uint32_t> row(keep);
+        for (int y = 0; y < keep; y++) {
+            readRow(y, 0, keep, row.data());
+            resized.writeRow(y, 0, keep, row.data());
+        }
+    }
+
+    *this = std::move(resized);
+}
+
+size_t PixelStorage::getMemoryUsage() const {
+    return m_mask.getMemoryUsage()
+        + m_palette.size() * sizeof(uint32_t)
+        + m_indices.size() * sizeof(uint8_t)
+        + m_colors.size() * sizeof(uint32_t)
+        + m_tiles.size() * sizeof(std::unique_ptr<Tile>)
+        + getTileCount() * sizeof(Tile);
+}
+
+int PixelStorage::getTileCount() const {
+    int count = 0;
+    for (const auto& tile : m_tiles) {
+        if (tile) count++;
+    }
+    return count;
+}
+
+uint32_t PixelStorage::get(int x, int y) const {
+    switch (m_format) {
+    case PixelFormat::Mask:
+        return isCovered(x, y) ? m_maskColor : 0;
+    case PixelFormat::Palette:
+        return m_palette[m_indices[y * m_size + x]];
+    case PixelFormat::RGBA:
+        return m_colors[y * m_size + x];
+    default: {
+        const Tile* tile = m_tiles[(y / TILE_SIZE) * m_tilesPerRow + x / TILE_SIZE].get();
+        return tile ? tile->pixels[(y % TILE_SIZE) * TILE_SIZE + x % TILE_SIZE] : 0;
+    }
+    }
+}
+
+void PixelStorage::set(int x, int y, uint32_t color) {
+    int index = y * m_size + x;
+    uint64_t& word = m_mask.row(y)[x >> 6];
+    uint64_t bit = 1ull << (x & 63);
+    bool wasCovered = (word & bit) != 0;
+
+    if (packedAlpha(color) == 0) {
+        if (!wasCovered) return;
+
+        word &= ~bit;
+        m_coveredCount--;
+
+        if (m_format == PixelFormat::Palette) {
+            m_indices[index] = 0;
+        }
+        else if (m_format == PixelFormat::RGBA) {
+            m_colors[index] = 0;
+        }
+        else if (m_format == PixelFormat::Tiled) {
+            // Release tiles as soon as they become empty
+            std::unique_ptr<Tile>& tile = m_tiles[(y / TILE_SIZE) * m_tilesPerRow + x / TILE_SIZE];
+            tile->pixels[(y % TILE_SIZE) * TILE_SIZE + x % TILE_SIZE] = 0;
+            if (--tile->coveredCount == 0) {
+                tile.reset();
+            }
+        }
+        return;
+    }
+
+    if (m_format == PixelFormat::Mask) {
+        // An empty mask adopts the first color written to it
+        if (m_coveredCount == 0) {
+            m_maskColor = color;
+        }
+
+        if (color != m_maskColor) {
+            if (m_size >= TILED_MIN_SIZE) {
+                convertToTiled();
+            }
+            else {
+                convertToPalette();
+            }
+        }
+    }
+
+    if (m_format == PixelFormat::Palette) {
+        int paletteIndex = findPaletteIndex(color);
+        if (paletteIndex >= 0) {
+            m_indices[index] = (uint8_t)paletteIndex;
+        }
+        else {
+            convertToRGBA();
+        }
+    }
+
+    if (m_format == PixelFormat::RGBA) {
+        m_colors[index] = color;
+    }
+    else if (m_format == PixelFormat::Tiled) {
+        Tile& tile = tileAt(x, y);
+        tile.pixels[(y % TILE_SIZE) * TILE_SIZE + x % TILE_SIZE] = color;
+        if (!wasCovered) {
+            tile.coveredCount++;
+        }
+    }
+
+    if (!wasCovered) {
+        word |= bit;
+        m_coveredCount++;
+    }
+}
+
+void PixelStorage::clearRect(const PixelRect& rect) {
+    int minX = std::max(rect.minX, 0);
+    int minY = std::max(rect.minY, 0);
+    int maxX = std::min(rect.maxX, m_size);
+    int maxY = std::min(rect.maxY, m_size);
+    if (minX >= maxX || minY >= maxY) return;
+
+    const PixelKernels& kernels = PixelKernels::get();
+
+    // Tiles entirely inside the rectangle are released, the rest are cleared below
+    if (m_format == PixelFormat::Tiled) {
+        for (int ty = minY / TILE_SIZE; ty <= (maxY - 1) / TILE_SIZE; ty++) {
+            for (int tx = minX / TILE_SIZE; tx <= (maxX - 1) / TILE_SIZE; tx++) {
+                std::unique_ptr<Tile>& tile = m_tiles[ty * m_tilesPerRow + tx];
+                if (!tile) continue;
+
+                int tileMinX = tx * TILE_SIZE, tileMinY = ty * TILE_SIZE;
+                int tileMaxX = std::min(tileMinX + TILE_SIZE, m_size);
+                int tileMaxY = std::min(tileMinY + TILE_SIZE, m_size);
+                if (tileMinX >= minX && tileMaxX <= maxX && tileMinY >= minY && tileMaxY <= maxY) {
+                    tile.reset();
+                    continue;
+                }
+
+                PixelRect part(std::max(minX, tileMinX), std::max(minY, tileMinY),
+                    std::min(maxX, tileMaxX), std::min(maxY, tileMaxY));
+                tile->coveredCount -= countCovered(part);
+                for (int y = part.minY; y < part.maxY; y++) {
+                    kernels.fillRow(&tile->pixels[(y - tileMinY) * TILE_SIZE + (part.minX - tileMinX)], part.width(), 0);
+                }
+                if (tile->coveredCount == 0) {
+                    tile.reset();
+                }
+            }
+        }
+    }
+
+    // Clear the covered bits word by word
+    m_coveredCount -= m_mask.visit([&](auto& mask) {
+        return forEachMaskWord(mask, PixelRect(minX, minY, maxX, maxY), [](uint64_t& word, uint64_t bits) {
+            int cleared = std::popcount(word & bits);
+            word &= ~bits;
+            return cleared;
+        });
+    });
+
+    for (int y = minY; y < maxY; y++) {
+        if (m_format == PixelFormat::Palette) {
+            std::fill_n(m_indices.begin() + y * m_size + minX, maxX - minX, (uint8_t)0);
+        }
+        else if (m_format == PixelFormat::RGBA) {
+            kernels.fillRow(&m_colors[y * m_size + minX], maxX - minX, 0);
+        }
+    }
+
+    // Nothing left: drop back to the smallest format
+    if (m_coveredCount == 0 && m_format != PixelFormat::Mask) {
+        reset(m_size);
+    }
+}
+
+bool PixelStorage::fillRect(const PixelRect& rect, uint32_t color) {
+    PixelRect clipped(std::max(rect.minX, 0), std::max(rect.minY, 0),
+        std::min(rect.maxX, m_size), std::min(rect.maxY, m_size));
+    if (clipped.isEmpty()) return false;
+
+    if (packedAlpha(color) == 0) {
+        int coveredCount = m_coveredCount;
+        clearRect(clipped);
+        return m_coveredCount != coveredCount;
+    }
+
+    if (m_format == PixelFormat::Mask) {
+        // An empty mask adopts the first color written to it
+        if (m_coveredCount == 0) {
+            m_maskColor = color;
+        }
+
+        if (color == m_maskColor) {
+            return setCovered(clipped) > 0;
+        }
+
+        if (m_size >= TILED_MIN_SIZE) {
+            convertToTiled();
+        }
+        else {
+            convertToPalette();
+        }
+    }
+
+    if (m_format == PixelFormat::Palette) {
+        int paletteIndex = findPaletteIndex(color);
+        if (paletteIndex < 0) {
+            convertToRGBA();
+        }
+        else {
+            bool changed = false;
+            for (int y = clipped.minY; y < clipped.maxY; y++) {
+                auto row = m_indices.begin() + y * m_size + clipped.minX;
+                changed = changed || std::any_of(row, row + clipped.width(), [&](uint8_t index) { return index != paletteIndex; });
+                std::fill_n(row, clipped.width(), (uint8_t)paletteIndex);
+            }
+            setCovered(clipped);
+            return changed;
+        }
+    }
+
+    const PixelKernels& kernels = PixelKernels::get();
+    int changed = 0;
+
+    if (m_format == PixelFormat::RGBA) {
+        for (int y = clipped.minY; y < clipped.maxY; y++) {
+            changed += kernels.fillRow(&m_colors[y * m_size + clipped.minX], clipped.width(), color);
+        }
+    }
+    else {
+        for (int ty = clipped.minY / TILE_SIZE; ty <= (clipped.maxY - 1) / TILE_SIZE; ty++) {
+            for (int tx = clipped.minX / TILE_SIZE; tx <= (clipped.maxX - 1) / TILE_SIZE; tx++) {
+                int tileMinX = tx * TILE_SIZE, tileMinY = ty * TILE_SIZE;
+                PixelRect part(std::max(clipped.minX, tileMinX), std::max(clipped.minY, tileMinY),
+                    std::min(clipped.maxX, tileMinX + TILE_SIZE), std::min(clipped.maxY, tileMinY + TILE_SIZE));
+
+                Tile& tile = tileAt(tileMinX, tileMinY);
+                tile.coveredCount += part.width() * part.height() - countCovered(part);
+                for (int y = part.minY; y < part.maxY; y++) {
+                    changed += kernels.fillRow(&tile.pixels[(y - tileMinY) * TILE_SIZE + (part.minX - tileMinX)], part.width(), color);
+                }
+            }
+        }
+    }
+
+    setCovered(clipped);
+    return changed > 0;
+}
+
+void PixelStorage::readRow(int y, int x, int count, uint32_t* out) const {
+    int index = y * m_size + x;
+
+    switch (m_format) {
+    case PixelFormat::Mask: {
+        // Expand the coverage bits into the single color without branching
+        const uint64_t* row = m_mask.row(y);
+        for (int i = 0; i < count; i++) {
+            uint32_t bit = (uint32_t)(row[(x + i) >> 6] >> ((x + i) & 63)) & 1;
+            out[i] = m_maskColor & (0u - bit);
+        }
+        break;
+    }
+    case PixelFormat::Palette:
+        for (int i = 0; i < count; i++) {
+            out[i] = m_palette[m_indices[index + i]];
+        }
+        break;
+    case PixelFormat::RGBA:
+        PixelKernels::get().copyRow(out, &m_colors[index], count);
+        break;
+    default: {
+        // Copy tile by tile; missing tiles are transparent
+        const PixelKernels& kernels = PixelKernels::get();
+        while (count > 0) {
+            int inTile = std::min(TILE_SIZE - x % TILE_SIZE, count);
+            const Tile* tile = m_tiles[(y / TILE_SIZE) * m_tilesPerRow + x / TILE_SIZE].get();
+            if (tile) {
+                kernels.copyRow(out, &tile->pixels[(y % TILE_SIZE) * TILE_SIZE + x % TILE_SIZE], inTile);
+            }
+            else {
+                kernels.fillRow(out, inTile, 0);
+            }
+            x += inTile;
+            out += inTile;
+            count -= inTile;
+        }
+        break;
+    }
+    }
+}
+
+std::span<const uint32_t> PixelStorage::getRow(int y, int x, int count, uint32_t* scratch) const {
+    if (count <= 0) return {};
+
+    if (m_format == PixelFormat::RGBA) {
+        return std::span<const uint32_t>(&m_colors[y * m_size + x], count);
+    }
+
+    // A run inside one allocated tile is contiguous too
+    if (m_format == PixelFormat::Tiled && x / TILE_SIZE == (x + count - 1) / TILE_SIZE) {
+        const Tile* tile = m_tiles[(y / TILE_SIZE) * m_tilesPerRow + x / TILE_SIZE].get();
+        if (tile) {
+            return std::span<const uint32_t>(&tile->pixels[(y % TILE_SIZE) * TILE_SIZE + x % TILE_SIZE], count);
+        }
+    }
+
+    readRow(y, x, count, scratch);
+    return std::span<const uint32_t>(scratch, count);
+}
+
+void PixelStorage::writeRow(int y, int x, int count, const uint32_t* pixels) {
+    // A row holding nothing but the mask color only changes coverage bits
+    if (m_format == PixelFormat::Mask) {
+        int i = 0;
+        uint32_t color = m_coveredCount > 0 ? m_maskColor : 0;
+        for (; i < count; i++) {
+            if (packedAlpha(pixels[i]) == 0) continue;
+            if (color == 0) color = pixels[i];
+            if (pixels[i] != color) break;
+        }
+        if (i == count) {
+            if (color != 0) m_maskColor = color;
+            rescanCoverage(y, x, count, pixels);
+            return;
+        }
+    }
+
+    // Narrow formats may have to widen, which set() takes care of
+    if (m_format == PixelFormat::Mask || m_format == PixelFormat::Palette) {
+        for (int i = 0; i < count; i++) {
+            set(x + i, y, pixels[i]);
+            if (m_format == PixelFormat::RGBA || m_format == PixelFormat::Tiled) {
+                writeRow(y, x + i + 1, count - i - 1, pixels + i + 1);
+                return;
+            }
+        }
+        return;
+    }
+
+    const PixelKernels& kernels = PixelKernels::get();
+
+    if (m_format == PixelFormat::RGBA) {
+        uint32_t* dst = &m_colors[y * m_size + x];
+        kernels.copyRow(dst, pixels, count);
+        kernels.clearTransparent(dst, count);
+        rescanCoverage(y, x, count, dst);
+        return;
+    }
+
+    while (count > 0) {
+        int inTile = std::min(TILE_SIZE - x % TILE_SIZE, count);
+        std::unique_ptr<Tile>& tile = m_tiles[(y / TILE_SIZE) * m_tilesPerRow + x / TILE_SIZE];
+
+        // Don't allocate a tile just to store transparent pixels
+        uint64_t bits;
+        if (tile || kernels.scanAlpha(pixels, inTile, &bits) > 0) {
+            Tile& target = tileAt(x, y);
+            uint32_t* dst = &target.pixels[(y % TILE_SIZE) * TILE_SIZE + x % TILE_SIZE];
+            target.coveredCount -= countCovered(PixelRect(x, y, x + inTile, y + 1));
+            kernels.copyRow(dst, pixels, inTile);
+            kernels.clearTransparent(dst, inTile);
+            target.coveredCount += rescanCoverage(y, x, inTile, dst);
+            if (target.coveredCount == 0) {
+                tile.reset();
+            }
+        }
+
+        x += inTile;
+        pixels += inTile;
+        count -= inTile;
+    }
+}
+
+int PixelStorage::replaceColor(uint32_t from, uint32_t to) {
+    if (packedAlpha(from) == 0 || from == to || m_coveredCount == 0) return 0;
+
+    // Pixels replaced by a transparent color are erased
+    uint32_t target = packedAlpha(to) != 0 ? to : 0;
+    int replaced = 0;
+
+    switch (m_format) {
+    case PixelFormat::Mask:
+        if (m_maskColor != from) return 0;
+
+        replaced = m_coveredCount;
+        if (packedAlpha(target) == 0) {
+            reset(m_size);
+        }
+        else {
+            m_maskColor = target;
+        }
+        return replaced;
+
+    case PixelFormat::Palette: {
+        // Remap every entry holding from, merging into an existing entry for to
+        uint8_t remap[256];
+        bool affected[256] = {};
+        int targetIndex = 0;
+        for (int i = 1; i < (int)m_palette.size(); i++) {
+            if (packedAlpha(target) != 0 && m_palette[i] == target) {
+                targetIndex = i;
+                break;
+            }
+        }
+        for (int i = 0; i < (int)m_palette.size(); i++) {
+            remap[i] = (uint8_t)i;
+            if (i == 0 || m_palette[i] != from) continue;
+
+            affected[i] = true;
+            if (packedAlpha(target) != 0 && targetIndex == 0) {
+                m_palette[i] = target;
+                targetIndex = i;
+            }
+            remap[i] = (uint8_t)targetIndex;
+        }
+
+        for (int index = 0; index < m_size * m_size; index++) {
+            uint8_t& entry = m_indices[index];
+            if (!affected[entry]) continue;
+
+            replaced++;
+            entry = remap[entry];
+            if (entry == 0) {
+                m_mask.row(index / m_size)[(index % m_size) >> 6] &= ~(1ull << ((index % m_size) & 63));
+                m_coveredCount--;
+            }
+        }
+        break;
+    }
+
+    case PixelFormat::RGBA: {
+        const PixelKernels& kernels = PixelKernels::get();
+        replaced = kernels.replaceColor(m_colors.data(), m_size * m_size, from, target);
+        if (replaced > 0 && packedAlpha(target) == 0) {
+            for (int y = 0; y < m_size; y++) {
+                rescanCoverage(y, 0, m_size, &m_colors[y * m_size]);
+            }
+        }
+        break;
+    }
+
+    default: {
+        // Tile padding past the grid edge is transparent and never matches from
+        const PixelKernels& kernels = PixelKernels::get();
+        for (int ty = 0; ty < m_tilesPerRow; ty++) {
+            for (int tx = 0; tx < m_tilesPerRow; tx++) {
+                Tile* tile = m_tiles[ty * m_tilesPerRow + tx].get();
+                if (!tile) continue;
+
+                int tileReplaced = kernels.replaceColor(tile->pixels, TILE_SIZE * TILE_SIZE, from, target);
+                replaced += tileReplaced;
+                if (tileReplaced > 0 && packedAlpha(target) == 0) {
+                    rescanTile(tx, ty);
+                }
+            }
+        }
+        break;
+    }
+    }
+
+    if (m_coveredCount == 0) {
+        reset(m_size);
+    }
+    return replaced;
+}
+
+void PixelStorage::multiplyAlpha(uint8_t factor) {
+    if (factor == 255 || m_coveredCount == 0) return;
+
+    switch (m_format) {
+    case PixelFormat::Mask:
+        m_maskColor = withAlpha(m_maskColor, scaleAlpha(packedAlpha(m_maskColor), factor));
+        if (m_maskColor == 0) {
+            reset(m_size);
+        }
+        return;
+
+    case PixelFormat::Palette: {
+        // Entries that fade out completely release their pixels
+        bool erased[256] = {};
+        bool anyErased = false;
+        for (int i = 1; i < (int)m_palette.size(); i++) {
+            m_palette[i] = withAlpha(m_palette[i], scaleAlpha(packedAlpha(m_palette[i]), factor));
+            if (m_palette[i] == 0) {
+                erased[i] = true;
+                anyErased = true;
+            }
+        }
+
+        if (anyErased) {
+            for (int index = 0; index < m_size * m_size; index++) {
+                uint8_t& entry = m_indices[index];
+                if (entry != 0 && erased[entry]) {
+                    entry = 0;
+                    m_mask.row(index / m_size)[(index % m_size) >> 6] &= ~(1ull << ((index % m_size) & 63));
+                    m_coveredCount--;
+                }
+            }
+        }
+        break;
+    }
+
+    case PixelFormat::RGBA: {
+        const PixelKernels& kernels = PixelKernels::get();
+        kernels.multiplyAlpha(m_colors.data(), m_size * m_size, factor);
+        for (int y = 0; y < m_size; y++) {
+            rescanCoverage(y, 0, m_size, &m_colors[y * m_size]);
+        }
+        break;
+    }
+
+    default: {
+        const PixelKernels& kernels = PixelKernels::get();
+        for (int ty = 0; ty < m_tilesPerRow; ty++) {
+            for (int tx = 0; tx < m_tilesPerRow; tx++) {
+                Tile* tile = m_tiles[ty * m_tilesPerRow + tx].get();
+                if (!tile) continue;
+
+                kernels.multiplyAlpha(tile->pixels, TILE_SIZE * TILE_SIZE, factor);
+                rescanTile(tx, ty);
+            }
+        }
+        break;
+    }
+    }
+
+    if (m_coveredCount == 0) {
+        reset(m_size);
+    }
+}
+
+int PixelStorage::findPaletteIndex(uint32_t color) {
+    // Consecutive writes usually repeat the same color
+    if (m_palette[m_lastPaletteIndex] == color) {
+        return m_lastPaletteIndex;
+    }
+
+    for (int i = 1; i < (int)m_palette.size(); i++) {
+        if (m_palette[i] == color) {
+            m_lastPaletteIndex = i;
+            return i;
+        }
+    }
+
+    if (m_palette.size() >= 256) {
+        return -1;
+    }
+
+    m_palette.push_back(color);
+    m_lastPaletteIndex = (int)m_palette.size() - 1;
+    return m_lastPaletteIndex;
+}
+
+void PixelStorage::convertToPalette() {
+    m_palette.assign(1, 0);
+    m_indices.assign(m_size * m_size, 0);
+    m_lastPaletteIndex = 0;
+
+    if (m_coveredCount > 0) {
+        m_palette.push_back(m_maskColor);
+        for (int y = 0; y < m_size; y++) {
+            forEachSpan(y, [&](int startX, int endX) {
+                std::fill_n(m_indices.begin() + y * m_size + startX, endX - startX, (uint8_t)1);
+            });
+        }
+    }
+
+    m_format = PixelFormat::Palette;
+}
+
+void PixelStorage::convertToRGBA() {
+    m_colors.resize(m_size * m_size);
+    for (int i = 0; i < m_size * m_size; i++) {
+        m_colors[i] = m_palette[m_indices[i]];
+    }
+
+    std::vector<uint32_t>().swap(m_palette);
+    std::vector<uint8_t>().swap(m_indices);
+    m_lastPaletteIndex = 0;
+
+    m_format = PixelFormat::RGBA;
+}
+
+void PixelStorage::convertToTiled() {
+    m_tiles.resize(m_tilesPerRow * m_tilesPerRow);
+
+    // Only the mask format widens to tiles
+    for (int y = 0; y < m_size; y++) {
+        forEachSpan(y, [&](int startX, int endX) {
+            for (int x = startX; x < endX; x++) {
+                Tile& tile = tileAt(x, y);
+                tile.pixels[(y % TILE_SIZE) * TILE_SIZE + x % TILE_SIZE] = m_maskColor;
+                tile.coveredCount++;
+            }
+        });
+    }
+
+    m_format = PixelFormat::Tiled;
+}
+
+PixelStorage::Tile& PixelStorage::tileAt(int x, int y) {
+    std::unique_ptr<Tile>& tile = m_tiles[(y / TILE_SIZE) * m_tilesPerRow + x / TILE_SIZE];
+    if (!tile) {
+        tile = std::make_unique<Tile>();
+    }
+    return *tile;
+}
+
+int PixelStorage::countCovered(const PixelRect& rect) const {
+    return m_mask.visit([&](const auto& mask) {
+        return forEachMaskWord(mask, rect, [](uint64_t word, uint64_t bits) {
+            return std::popcount(word & bits);
+        });
+    });
+}
+
+int PixelStorage::setCovered(const PixelRect& rect) {
+    int added = m_mask.visit([&](auto& mask) {
+        return forEachMaskWord(mask, rect, [](uint64_t& word, uint64_t bits) {
+            int added = std::popcount(bits & ~word);
+            word |= bits;
+            return added;
+        });
+    });
+    m_coveredCount += added;
+    return added;
+}
+
+int PixelStorage::rescanCoverage(int y, int x, int count, const uint32_t* pixels) {
+    const PixelKernels& kernels = PixelKernels::get();
+    uint64_t* row = m_mask.row(y);
+    int covered = 0;
+
+    // Scan at most one mask word at a time so the bits can be merged at any offset
+    while (count > 0) {
+        int lo = x & 63;
+        int n = std::min(64 - lo, count);
+        uint64_t bits;
+        covered += kernels.scanAlpha(pixels, n, &bits);
+
+        uint64_t span = spanBits(lo, lo + n);
+        uint64_t& word = row[x >> 6];
+        m_coveredCount += std::popcount(bits) - std::popcount(word & span);
+        word = (word & ~span) | (bits << lo);
+
+        x += n;
+        pixels += n;
+        count -= n;
+    }
+
+    return covered;
+}
+
+void PixelStorage::rescanTile(int tileX, int tileY) {
+    std::unique_ptr<Tile>& tile = m_tiles[tileY * m_tilesPerRow + tileX];
+    if (!tile) return;
+
+    int minX = tileX * TILE_SIZE, minY = tileY * TILE_SIZE;
+    int width = std::min(TILE_SIZE, m_size - minX);
+    int height = std::min(TILE_SIZE, m_size - minY);
+
+    tile->coveredCount = 0;
+    for (int y = 0; y < height; y++) {
+        tile->coveredCount += rescanCoverage(minY + y, minX, width, &tile->pixels[y * TILE_SIZE]);
+    }
+
+    if (tile->coveredCount == 0) {
+        tile.reset();
+    }
+}
\ No newline at end of file
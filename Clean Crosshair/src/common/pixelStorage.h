@@ -0,0 +1,189 @@
+#pragma once
+
+#include <vector>
+#include <memory>
+#include <cstdint>
+#include <cstddef>
+#include <span>
+#include <bit>
+#include <algorithm>
+#include "pixel.h"
+#include "coveragePlane.h"
+
+// Internal representation used by PixelStorage
+enum class PixelFormat {
+    Mask,     // 1 bit per pixel plus a single color
+    Palette,  // 8-bit index per pixel into up to 255 colors
+    RGBA,     // full color per pixel
+    Tiled     // full color per pixel in 16x16 tiles, empty tiles not allocated
+};
+
+// Square pixel grid that keeps its content in the most compact format able to
+// represent it, falling back to a wider format when a write needs more colors.
+// Grids larger than TILED_MIN_SIZE widen from the mask straight to sparse tiles.
+// A coverage bitmask (one bit per non-transparent pixel) is kept in every format
+// so empty space can be skipped a 64-bit word at a time.
+// Pixels are packed 32-bit colors (see pixel.h); transparent pixels are always 0.
+class PixelStorage {
+public:
+    static constexpr int TILE_SIZE = 16;
+    static constexpr int TILED_MIN_SIZE = 129;
+
+    PixelStorage();
+    explicit PixelStorage(int size);
+
+    // Reset to an empty grid of the given size
+    void reset(int size);
+
+    // Replace the content with size * size row-major pixels
+    void assign(int size, std::span<const uint32_t> pixels);
+
+    // Change the size, keeping the top-left content
+    void resize(int newSize);
+
+    int getSize() const { return m_size; }
+    PixelFormat getFormat() const { return m_format; }
+
+    // Number of non-transparent pixels
+    int getCoveredCount() const { return m_coveredCount; }
+
+    // Bytes used by the pixel data
+    size_t getMemoryUsage() const;
+
+    // Unchecked accessors; coordinates must be inside the grid
+    uint32_t get(int x, int y) const;
+    void set(int x, int y, uint32_t color);
+    bool isCovered(int x, int y) const {
+        return (m_mask.row(y)[x >> 6] >> (x & 63)) & 1;
+    }
+
+    // Make a rectangle transparent
+    void clearRect(const PixelRect& rect);
+
+    // Set every pixel of a rectangle to color; returns false if none changed
+    bool fillRect(const PixelRect& rect, uint32_t color);
+
+    // Decode count pixels of row y starting at x
+    void readRow(int y, int x, int count, uint32_t* out) const;
+
+    // View of count pixels of row y starting at x. Points straight into the
+    // storage when the pixels are stored contiguously, otherwise they are
+    // decoded into scratch (which must hold count pixels)
+    std::span<const uint32_t> getRow(int y, int x, int count, uint32_t* scratch) const;
+
+    // Overwrite count pixels of row y starting at x
+    void writeRow(int y, int x, int count, const uint32_t* pixels);
+
+    // Replace every pixel of color from (which must be opaque) with to,
+    // returning how many pixels were replaced
+    int replaceColor(uint32_t from, uint32_t to);
+
+    // Scale the alpha of every pixel by factor / 255
+    void multiplyAlpha(uint8_t factor);
+
+    // Number of allocated tiles (Tiled format only)
+    int getTileCount() const;
+
+    // Call fn(rect) for every region that may hold non-transparent pixels:
+    // each allocated tile in the tiled format, otherwise the whole grid
+    template <typename Fn>
+    void forEachRegion(Fn&& fn) const {
+        if (m_format != PixelFormat::Tiled) {
+            if (m_coveredCount > 0) {
+                fn(PixelRect(0, 0, m_size, m_size));
+            }
+            return;
+        }
+
+        for (int ty = 0; ty < m_tilesPerRow; ty++) {
+            for (int tx = 0; tx < m_tilesPerRow; tx++) {
+                if (m_tiles[ty * m_tilesPerRow + tx]) {
+                    fn(PixelRect(tx * TILE_SIZE, ty * TILE_SIZE,
+                        std::min((tx + 1) * TILE_SIZE, m_size), std::min((ty + 1) * TILE_SIZE, m_size)));
+                }
+            }
+        }
+    }
+
+    // Call fn(startX, endX) for every run of non-transparent pixels in row y
+    // (endX exclusive), scanning the coverage mask a word at a time
+    template <typename Fn>
+    void forEachSpan(int y, Fn&& fn) const {
+        m_mask.visit([&](const auto& mask) { forEachSpan(mask, y, fn); });
+    }
+
+private:
+    struct Tile {
+        uint32_t pixels[TILE_SIZE * TILE_SIZE];
+        int coveredCount;
+    };
+
+    // Span scan specialized for the mask's extent
+    template <typename Mask, typename Fn>
+    static void forEachSpan(const Mask& mask, int y, Fn& fn) {
+        const uint64_t* row = mask.row(y);
+        int runStart = -1;
+
+        for (int w = 0; w < mask.wordsPerRow(); w++) {
+            uint64_t bits = row[w];
+            int base = w * 64;
+            int bit = 0;
+
+            while (bit < 64) {
+                if (runStart < 0) {
+                    uint64_t rest = bits >> bit;
+                    if (rest == 0) break;
+                    bit += std::countr_zero(rest);
+                    runStart = base + bit;
+                }
+
+                // Remaining bits all set: the run continues into the next word
+                uint64_t gaps = ~bits >> bit;
+                if (gaps == 0) break;
+
+                bit += std::countr_zero(gaps);
+                fn(runStart, base + bit);
+                runStart = -1;
+            }
+        }
+
+        if (runStart >= 0) {
+            fn(runStart, mask.size());
+        }
+    }
+
+    int m_size;
+    int m_coveredCount;
+    PixelFormat m_format;
+
+    CoveragePlane m_mask;             // Coverage bits, used by every format
+    uint32_t m_maskColor;             // Mask: color of every covered pixel
+    std::vector<uint32_t> m_palette;  // Palette: entry 0 is transparent
+    std::vector<uint8_t> m_indices;   // Palette: one index per pixel
+    std::vector<uint32_t> m_colors;   // RGBA: one color per pixel
+    std::vector<std::unique_ptr<Tile>> m_tiles;  // Tiled: null for empty tiles
+    int m_tilesPerRow;
+    int m_lastPaletteIndex;
+
+    // Find or add a palette entry (-1 if the palette is full)
+    int findPaletteIndex(uint32_t color);
+
+    // Widen the representation
+    void convertToPalette();
+    void convertToRGBA();
+    void convertToTiled();
+
+    // Tile holding pixel (x, y), allocated on demand
+    Tile& tileAt(int x, int y);
+
+    // Count or set the coverage bits of a rectangle (already clipped)
+    int countCovered(const PixelRect& rect) const;
+    int setCovered(const PixelRect& rect);
+
+    // Rebuild the coverage bits of count pixels of row y from their alpha,
+    // returning how many are covered
+    int rescanCoverage(int y, int x, int count, const uint32_t* pixels);
+
+    // Rebuild a tile's coverage, releasing it if nothing is left
+    void rescanTile(int tileX, int tileY);
+};
\ No newline at end of file
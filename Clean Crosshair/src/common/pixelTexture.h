@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstdint>
+
+struct ImDrawList;
+
+// GPU texture holding an RGBA8 image, implemented by the renderer backend
+class PixelTexture {
+public:
+    virtual ~PixelTexture() {}
+
+    // Current dimensions (0 before the first upload)
+    virtual int getWidth() const = 0;
+    virtual int getHeight() const = 0;
+
+    // Upload a sub-rectangle of a width x height RGBA8 image. 'pixels' points at the
+    // rectangle's first pixel with rows 'pitch' pixels apart. The texture is recreated
+    // when the dimensions change; the caller must then upload the whole image.
+    virtual bool upload(int width, int height, int x, int y, int w, int h, const uint32_t* pixels, int pitch) = 0;
+
+    // Draw the texture into a screen rectangle using point sampling
+    virtual void draw(ImDrawList* drawList, float minX, float minY, float maxX, float maxY) = 0;
+
+    // Draw the w x h texels at x, y into a screen rectangle using point sampling
+    virtual void drawRegion(ImDrawList* drawList, float minX, float minY, float maxX, float maxY,
+        int x, int y, int w, int h) = 0;
+
+    // Draw many regions with one switch to point sampling and back:
+    // addRegion only adds a textured quad, so consecutive regions share a
+    // single draw command
+    virtual void beginRegions(ImDrawList* drawList) = 0;
+    virtual void addRegion(ImDrawList* drawList, float minX, float minY, float maxX, float maxY,
+        int x, int y, int w, int h) = 0;
+    virtual void endRegions(ImDrawList* drawList) = 0;
+};
\ No newline at end of file
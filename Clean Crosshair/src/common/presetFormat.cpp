@@ -0,0 +1,302 @@
+#include "presetFormat.h"
+#include "contentHash.h"
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <bit>
+
+// Repeat packets cover 2 to 129 pixels, literal packets 1 to 128
+static constexpr int MAX_REPEAT = 129;
+static constexpr int MAX_LITERAL = 128;
+
+static constexpr std::array<uint32_t, 256> makeCrcTable() {
+    std::array<uint32_t, 256> table{};
+    for (uint32_t i = 0; i < 256; i++) {
+        uint32_t c = i;
+        for (int k = 0; k < 8; k++) {
+            c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+        }
+        table[i] = c;
+    }
+    return table;
+}
+
+static constexpr std::array<uint32_t, 256> s_crcTable = makeCrcTable();
+
+static uint32_t get32(const unsigned char* p) {
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static uint64_t get64(const unsigned char* p) {
+    return get32(p) | ((uint64_t)get32(p + 4) << 32);
+}
+
+// Counts and checksums the bytes written to it without storing them
+class ChecksumSink : public PresetSink {
+public:
+    ChecksumSink() : m_size(0), m_crc(0) {}
+
+    size_t getSize() const { return m_size; }
+    uint32_t getCrc() const { return m_crc; }
+
+protected:
+    bool flushBuffer(const char* data, size_t length) override {
+        m_size += length;
+        m_crc = PresetFormat::crc32(data, length, m_crc);
+        return true;
+    }
+
+private:
+    size_t m_size;
+    uint32_t m_crc;
+};
+
+// Packs pixels fed one at a time into RLE packets. Two or more equal pixels
+// always become a repeat packet; everything else is gathered into literals.
+class RLEEncoder {
+public:
+    explicit RLEEncoder(PresetSink& sink)
+        : m_sink(sink), m_runPixel(0), m_runCount(0), m_literalCount(0) {
+    }
+
+    void add(uint32_t pixel) {
+        if (m_runCount > 0 && pixel == m_runPixel) {
+            if (++m_runCount == MAX_REPEAT) {
+                writeRun();
+            }
+            return;
+        }
+
+        endRun();
+        m_runPixel = pixel;
+        m_runCount = 1;
+    }
+
+    void finish() {
+        endRun();
+        writeLiterals();
+    }
+
+private:
+    PresetSink& m_sink;
+    uint32_t m_runPixel;
+    int m_runCount;
+    std::array<uint32_t, MAX_LITERAL> m_literals;
+    int m_literalCount;
+
+    void endRun() {
+        if (m_runCount >= 2) {
+            writeRun();
+        }
+        else if (m_runCount == 1) {
+            if (m_literalCount == MAX_LITERAL) {
+                writeLiterals();
+            }
+            m_literals[m_literalCount++] = m_runPixel;
+            m_runCount = 0;
+        }
+    }
+
+    void writeRun() {
+        writeLiterals();
+        m_sink.put((char)(m_runCount + 126));
+        m_sink.put32(m_runPixel);
+        m_runCount = 0;
+    }
+
+    void writeLiterals() {
+        if (m_literalCount == 0) return;
+
+        m_sink.put((char)(m_literalCount - 1));
+        for (int k = 0; k < m_literalCount; k++) {
+            m_sink.put32(m_literals[k]);
+        }
+        m_literalCount = 0;
+    }
+};
+
+static void encodeRLE(int size, const PresetFormat::RowReader& readRow, PresetSink& sink) {
+    std::vector<uint32_t> row(size);
+    RLEEncoder encoder(sink);
+
+    for (int y = 0; y < size; y++) {
+        readRow(y, row.data());
+        for (uint32_t pixel : row) {
+            encoder.add(pixel);
+        }
+    }
+
+    encoder.finish();
+}
+
+static void encodeRaw(int size, const PresetFormat::RowReader& readRow, PresetSink& sink) {
+    std::vector<uint32_t> row(size);
+
+    for (int y = 0; y < size; y++) {
+        readRow(y, row.data());
+        for (uint32_t pixel : row) {
+            sink.put32(pixel);
+        }
+    }
+}
+
+static bool decodeRLE(const unsigned char* p, size_t length, std::vector<uint32_t>& pixels) {
+    size_t pos = 0, count = 0;
+
+    while (pos < length) {
+        int control = p[pos++];
+        if (control < 128) {
+            size_t n = control + 1;
+            if (pos + n * 4 > length || count + n > pixels.size()) return false;
+            for (size_t k = 0; k < n; k++, pos += 4) {
+                pixels[count++] = get32(p + pos);
+            }
+        }
+        else {
+            size_t n = control - 126;
+            if (pos + 4 > length || count + n > pixels.size()) return false;
+            std::fill_n(pixels.begin() + count, n, get32(p + pos));
+            pos += 4;
+            count += n;
+        }
+    }
+
+    return count == pixels.size();
+}
+
+bool PresetFormat::isBinary(std::string_view data) {
+    return data.size() >= sizeof(MAGIC) && std::memcmp(data.data(), MAGIC, sizeof(MAGIC)) == 0;
+}
+
+void PresetFormat::encode(int size, const RowReader& readRow, PresetSink& sink) {
+    size_t rawSize = (size_t)size * size * 4;
+
+    // The first pass over the rows also hashes them
+    ContentHasher hasher(size);
+    ChecksumSink rle;
+    encodeRLE(size, [&](int y, uint32_t* out) {
+        readRow(y, out);
+        hasher.addRow(out, size);
+    }, rle);
+    rle.finish();
+
+    PresetEncoding encoding = PresetEncoding::RLE;
+    size_t payloadSize = rle.getSize();
+    uint32_t checksum = rle.getCrc();
+
+    if (payloadSize >= rawSize) {
+        ChecksumSink raw;
+        encodeRaw(size, readRow, raw);
+        raw.finish();
+
+        encoding = PresetEncoding::Raw;
+        payloadSize = rawSize;
+        checksum = raw.getCrc();
+    }
+
+    sink.write(MAGIC, sizeof(MAGIC));
+    sink.put16(VERSION);
+    sink.put((char)encoding);
+    sink.put((char)0);
+    sink.put32((uint32_t)size);
+    sink.put32((uint32_t)size);
+    sink.put32((uint32_t)payloadSize);
+    sink.put32(checksum);
+    uint64_t contentHash = hasher.finish();
+    sink.put32((uint32_t)contentHash);
+    sink.put32((uint32_t)(contentHash >> 32));
+
+    if (encoding == PresetEncoding::RLE) {
+        encodeRLE(size, readRow, sink);
+    }
+    else {
+        encodeRaw(size, readRow, sink);
+    }
+}
+
+bool PresetFormat::readContentHash(std::string_view data, uint64_t& hash) {
+    if (data.size() < HEADER_SIZE || !isBinary(data)) return false;
+
+    const unsigned char* header = (const unsigned char*)data.data();
+    if ((header[4] | (header[5] << 8)) != VERSION) return false;
+
+    hash = get64(header + 24);
+    return true;
+}
+
+bool PresetFormat::decode(std::string_view data, int& size, std::vector<uint32_t>& pixels) {
+    std::span<const uint32_t> view;
+    std::vector<uint32_t> storage;
+    if (!decodeView(data, size, view, storage)) return false;
+
+    if (view.data() == storage.data()) {
+        pixels = std::move(storage);
+    }
+    else {
+        pixels.assign(view.begin(), view.end());
+    }
+    return true;
+}
+
+bool PresetFormat::decodeView(std::string_view data, int& size, std::span<const uint32_t>& pixels,
+    std::vector<uint32_t>& storage) {
+    if (data.size() < V2_HEADER_SIZE || !isBinary(data)) return false;
+
+    const unsigned char* header = (const unsigned char*)data.data();
+    uint16_t version = header[4] | (header[5] << 8);
+    uint8_t encoding = header[6];
+    uint32_t width = get32(header + 8);
+    uint32_t height = get32(header + 12);
+    uint32_t payloadSize = get32(header + 16);
+    uint32_t checksum = get32(header + 20);
+
+    if (version != VERSION && version != 2) return false;
+    size_t headerSize = version == 2 ? V2_HEADER_SIZE : HEADER_SIZE;
+    if (data.size() < headerSize) return false;
+    if (width == 0 || width > MAX_SIZE || height != width) return false;
+    if (payloadSize != data.size() - headerSize) return false;
+
+    const unsigned char* payload = header + headerSize;
+    if (crc32(payload, payloadSize) != checksum) return false;
+
+    size_t count = (size_t)width * height;
+
+    if (encoding == (uint8_t)PresetEncoding::Raw) {
+        if (payloadSize != count * 4) return false;
+
+        // Raw payloads already hold packed pixels in memory order on
+        // little-endian machines; mapped files are page aligned
+        if (std::endian::native == std::endian::little && (uintptr_t)payload % alignof(uint32_t) == 0) {
+            size = (int)width;
+            pixels = std::span<const uint32_t>((const uint32_t*)payload, count);
+            return true;
+        }
+
+        std::vector<uint32_t> decoded(count);
+        for (size_t i = 0; i < count; i++) {
+            decoded[i] = get32(payload + i * 4);
+        }
+        storage = std::move(decoded);
+    }
+    else if (encoding == (uint8_t)PresetEncoding::RLE) {
+        std::vector<uint32_t> decoded(count);
+        if (!decodeRLE(payload, payloadSize, decoded)) return false;
+        storage = std::move(decoded);
+    }
+    else {
+        return false;
+    }
+
+    size = (int)width;
+    pixels = storage;
+    return true;
+}
+
+uint32_t PresetFormat::crc32(const void* data, size_t length, uint32_t crc) {
+    const unsigned char* p = (const unsigned char*)data;
+    uint32_t c = crc ^ 0xFFFFFFFFu;
+    for (size_t i = 0; i < length; i++) {
+        c = s_crcTable[(c ^ p[i]) & 0xFF] ^ (c >> 8);
+    }
+    return c ^ 0xFFFFFFFFu;
+}
\ No newline at end of file
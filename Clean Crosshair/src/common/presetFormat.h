@@ -0,0 +1,80 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <span>
+#include <functional>
+#include <cstdint>
+#include <cstddef>
+#include "presetSink.h"
+
+// Binary .crosshair preset (version 3). Version 1 files are the CSV text written
+// by Crosshair::serialize and have no header; a file is binary when it starts
+// with MAGIC.
+//
+// Layout, all integers little-endian:
+//    0  char[4]  magic "CCXH"
+//    4  uint16   version
+//    6  uint8    encoding (PresetEncoding)
+//    7  uint8    reserved, 0
+//    8  uint32   width
+//   12  uint32   height (grids are square, so equal to width)
+//   16  uint32   payload size in bytes
+//   20  uint32   CRC-32 of the payload
+//   24  uint64   content hash of the pixels (see contentHash.h)
+//   32  payload
+//
+// Version 2 is the same without the content hash, so its payload starts at 24.
+// It is still decoded; saving or migrating a preset rewrites it as version 3.
+//
+// Raw payloads hold width * height pixels as r, g, b, a bytes, row-major.
+// RLE payloads are a sequence of packets: a control byte c < 128 is followed by
+// c + 1 literal pixels, c >= 128 by one pixel repeated c - 126 times.
+enum class PresetEncoding : uint8_t {
+    Raw = 0,
+    RLE = 1
+};
+
+class PresetFormat {
+public:
+    static constexpr char MAGIC[4] = { 'C', 'C', 'X', 'H' };
+    static constexpr uint16_t VERSION = 3;
+    static constexpr size_t HEADER_SIZE = 32;
+
+    // Header of version 2 presets, and the part every binary preset starts with
+    static constexpr size_t V2_HEADER_SIZE = 24;
+
+    // Largest grid accepted when decoding
+    static constexpr int MAX_SIZE = 4096;
+
+    // Whether data starts like a binary preset
+    static bool isBinary(std::string_view data);
+
+    // Supplies row y of the grid as size packed pixels (see pixel.h)
+    using RowReader = std::function<void(int y, uint32_t* out)>;
+
+    // Stream a size x size grid into sink, choosing whichever of raw and RLE is
+    // smaller. The header needs the payload's size, checksum and content hash
+    // up front, so every row is read two or three times instead of buffering
+    // the payload.
+    static void encode(int size, const RowReader& readRow, PresetSink& sink);
+
+    // Content hash from the header alone, without decoding or checking the
+    // payload. False for anything but a version 3 header, since older
+    // presets do not store one.
+    static bool readContentHash(std::string_view data, uint64_t& hash);
+
+    // Decode a binary preset; returns false on any malformed or corrupted input
+    static bool decode(std::string_view data, int& size, std::vector<uint32_t>& pixels);
+
+    // Decode without copying where possible: raw payloads are viewed in place
+    // on little-endian machines, anything else is decoded into storage. The
+    // pixels stay valid as long as data and storage do.
+    static bool decodeView(std::string_view data, int& size, std::span<const uint32_t>& pixels,
+        std::vector<uint32_t>& storage);
+
+    // CRC-32 (IEEE 802.3, as used by zip and PNG). Pass the previous result as
+    // crc to continue a checksum over consecutive blocks.
+    static uint32_t crc32(const void* data, size_t length, uint32_t crc = 0);
+};
\ No newline at end of file
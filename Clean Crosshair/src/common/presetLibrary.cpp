@@ -0,0 +1,321 @@
+#include "presetLibrary.h"
+#include "presetFormat.h"
+#include "presetSink.h"
+#include <fstream>
+#include <filesystem>
+#include <cstring>
+
+static uint16_t get16(const unsigned char* p) {
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static uint32_t get32(const unsigned char* p) {
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static uint64_t get64(const unsigned char* p) {
+    return get32(p) | ((uint64_t)get32(p + 4) << 32);
+}
+
+PresetLibrary::PresetLibrary()
+    : m_logEnd(0),
+    m_logRecords(0),
+    m_deadBytes(0),
+    m_liveBytes(0) {
+}
+
+bool PresetLibrary::open(const std::string& path) {
+    close();
+    m_path = path;
+
+    std::error_code error;
+    bool opened = std::filesystem::exists(path, error) ? load() : compact();
+    if (!opened) {
+        close();
+    }
+    return opened;
+}
+
+void PresetLibrary::close() {
+    m_map.close();
+    m_entries.clear();
+    m_path.clear();
+    m_logEnd = 0;
+    m_logRecords = 0;
+    m_deadBytes = 0;
+    m_liveBytes = 0;
+}
+
+std::vector<std::string> PresetLibrary::getNames() const {
+    std::vector<std::string> names;
+    names.reserve(m_entries.size());
+    for (const auto& [name, entry] : m_entries) {
+        names.push_back(name);
+    }
+    return names;
+}
+
+const PresetLibrary::Entry* PresetLibrary::find(const std::string& name) const {
+    auto it = m_entries.find(name);
+    return it != m_entries.end() ? &it->second : nullptr;
+}
+
+std::string_view PresetLibrary::getPayload(const std::string& name) const {
+    const Entry* entry = find(name);
+    if (!entry) return std::string_view();
+
+    return m_map.getData().substr((size_t)entry->offset, entry->size);
+}
+
+bool PresetLibrary::put(const std::string& name, std::string_view payload, uint64_t contentHash) {
+    if (!isOpen() || name.empty() || name.size() > UINT16_MAX) return false;
+    if (payload.size() < PresetFormat::V2_HEADER_SIZE || payload.size() > UINT32_MAX) return false;
+    if (!PresetFormat::isBinary(payload)) return false;
+
+    const unsigned char* header = (const unsigned char*)payload.data();
+    Entry entry;
+    entry.offset = 0;
+    entry.size = (uint32_t)payload.size();
+    entry.hash = PresetFormat::crc32(payload.data(), payload.size());
+    entry.contentHash = contentHash;
+    entry.width = get32(header + 8);
+    entry.height = get32(header + 12);
+
+    if (!appendRecord(PresetRecord::Put, name, entry, payload)) return false;
+
+    compactIfNeeded();
+    return true;
+}
+
+bool PresetLibrary::remove(const std::string& name) {
+    if (!isOpen() || !find(name)) return false;
+
+    Entry entry = {};
+    if (!appendRecord(PresetRecord::Remove, name, entry, std::string_view())) return false;
+
+    compactIfNeeded();
+    return true;
+}
+
+bool PresetLibrary::compact() {
+    std::string tempPath = m_path + ".tmp";
+
+    size_t indexSize = 0;
+    for (const auto& [name, entry] : m_entries) {
+        indexSize += INDEX_ENTRY_SIZE + name.size();
+    }
+
+    // Payloads follow the index in name order
+    {
+        FileSink sink(tempPath);
+        if (!sink.isOpen()) {
+            return false;
+        }
+
+        uint64_t offset = HEADER_SIZE + indexSize;
+        uint64_t logOffset = offset + m_liveBytes;
+
+        sink.write(MAGIC, sizeof(MAGIC));
+        sink.put16(VERSION);
+        sink.put16(0);
+        sink.put32((uint32_t)m_entries.size());
+        sink.put32((uint32_t)indexSize);
+        sink.put64(logOffset);
+
+        for (const auto& [name, entry] : m_entries) {
+            sink.put64(offset);
+            sink.put32(entry.size);
+            sink.put32(entry.hash);
+            sink.put64(entry.contentHash);
+            sink.put32(entry.width);
+            sink.put32(entry.height);
+            sink.put16((uint16_t)name.size());
+            sink.write(name.data(), name.size());
+            offset += entry.size;
+        }
+
+        for (const auto& [name, entry] : m_entries) {
+            std::string_view payload = getPayload(name);
+            sink.write(payload.data(), payload.size());
+        }
+
+        if (!sink.close()) {
+            std::filesystem::remove(tempPath);
+            return false;
+        }
+    }
+
+    // A mapped file cannot be replaced on Windows
+    m_map.close();
+
+    std::error_code error;
+    std::filesystem::rename(tempPath, m_path, error);
+    if (error) {
+        std::filesystem::remove(tempPath, error);
+        load();
+        return false;
+    }
+
+    return load();
+}
+
+bool PresetLibrary::load() {
+    m_entries.clear();
+    m_logRecords = 0;
+    m_deadBytes = 0;
+    m_liveBytes = 0;
+
+    if (!m_map.open(m_path)) return false;
+
+    std::string_view data = m_map.getData();
+    const unsigned char* base = (const unsigned char*)data.data();
+    size_t fileSize = data.size();
+
+    if (fileSize < HEADER_SIZE || std::memcmp(base, MAGIC, sizeof(MAGIC)) != 0) return false;
+    if (get16(base + 4) != VERSION) return false;
+
+    uint32_t entryCount = get32(base + 8);
+    uint32_t indexSize = get32(base + 12);
+    uint64_t logOffset = get64(base + 16);
+    if (indexSize > fileSize - HEADER_SIZE || logOffset < HEADER_SIZE + indexSize || logOffset > fileSize) return false;
+
+    // The index was written in one piece by compact(), so any damage fails the open
+    size_t pos = HEADER_SIZE;
+    size_t indexEnd = HEADER_SIZE + indexSize;
+    for (uint32_t i = 0; i < entryCount; i++) {
+        if (indexEnd - pos < INDEX_ENTRY_SIZE) return false;
+
+        const unsigned char* p = base + pos;
+        Entry entry;
+        entry.offset = get64(p);
+        entry.size = get32(p + 8);
+        entry.hash = get32(p + 12);
+        entry.contentHash = get64(p + 16);
+        entry.width = get32(p + 24);
+        entry.height = get32(p + 28);
+        size_t nameLength = get16(p + 32);
+        pos += INDEX_ENTRY_SIZE;
+
+        if (indexEnd - pos < nameLength) return false;
+        if (entry.offset > logOffset || entry.size > logOffset - entry.offset) return false;
+
+        std::string name((const char*)base + pos, nameLength);
+        pos += nameLength;
+
+        m_liveBytes += entry.size;
+        m_entries[name] = entry;
+    }
+
+    // Replay the appended records. Only the last one can have been torn, so
+    // it alone has its payload checked against the hash.
+    pos = (size_t)logOffset;
+    while (fileSize - pos >= RECORD_HEADER_SIZE) {
+        const unsigned char* p = base + pos;
+        uint8_t type = p[0];
+        Entry entry;
+        entry.size = get32(p + 1);
+        entry.hash = get32(p + 5);
+        entry.contentHash = get64(p + 9);
+        entry.width = get32(p + 17);
+        entry.height = get32(p + 21);
+        size_t nameLength = get16(p + 25);
+
+        size_t nameStart = pos + RECORD_HEADER_SIZE;
+        if (type > (uint8_t)PresetRecord::Remove) break;
+        if (fileSize - nameStart < nameLength || fileSize - nameStart - nameLength < entry.size) break;
+
+        entry.offset = nameStart + nameLength;
+        size_t recordEnd = (size_t)entry.offset + entry.size;
+        if (recordEnd == fileSize && PresetFormat::crc32(base + entry.offset, entry.size) != entry.hash) break;
+
+        std::string name((const char*)base + nameStart, nameLength);
+        auto it = m_entries.find(name);
+        if (it != m_entries.end()) {
+            m_deadBytes += it->second.size;
+            m_liveBytes -= it->second.size;
+            m_entries.erase(it);
+        }
+
+        if (type == (uint8_t)PresetRecord::Put) {
+            m_liveBytes += entry.size;
+            m_entries[name] = entry;
+        }
+
+        m_logRecords++;
+        pos = recordEnd;
+    }
+
+    m_logEnd = pos;
+
+    // Cut off a torn tail so the next append does not leave garbage behind it
+    if (m_logEnd < fileSize) {
+        m_map.close();
+
+        std::error_code error;
+        std::filesystem::resize_file(m_path, m_logEnd, error);
+        if (error || !m_map.open(m_path)) return false;
+    }
+
+    return true;
+}
+
+bool PresetLibrary::appendRecord(PresetRecord type, const std::string& name, const Entry& entry,
+    std::string_view payload) {
+    std::string header;
+    StringSink sink(header);
+    sink.put((char)type);
+    sink.put32(entry.size);
+    sink.put32(entry.hash);
+    sink.put64(entry.contentHash);
+    sink.put32(entry.width);
+    sink.put32(entry.height);
+    sink.put16((uint16_t)name.size());
+    sink.write(name.data(), name.size());
+    sink.finish();
+
+    // Written through a separate handle; the mapping is refreshed after
+    m_map.close();
+
+    bool written;
+    {
+        std::fstream file(m_path, std::ios::binary | std::ios::in | std::ios::out);
+        file.seekp((std::streamoff)m_logEnd);
+        file.write(header.data(), header.size());
+        file.write(payload.data(), payload.size());
+        file.flush();
+        written = file.is_open() && !file.fail();
+    }
+
+    if (!m_map.open(m_path)) {
+        close();
+        return false;
+    }
+
+    // A failed append leaves m_logEnd where it was, so the next one overwrites it
+    if (!written) return false;
+
+    auto it = m_entries.find(name);
+    if (it != m_entries.end()) {
+        m_deadBytes += it->second.size;
+        m_liveBytes -= it->second.size;
+        m_entries.erase(it);
+    }
+
+    if (type == PresetRecord::Put) {
+        Entry stored = entry;
+        stored.offset = m_logEnd + header.size();
+        m_liveBytes += stored.size;
+        m_entries[name] = stored;
+    }
+
+    m_logEnd += header.size() + payload.size();
+    m_logRecords++;
+    return true;
+}
+
+void PresetLibrary::compactIfNeeded() {
+    if (m_logRecords >= COMPACT_RECORD_LIMIT
+        || (m_deadBytes >= COMPACT_MIN_DEAD_BYTES && m_deadBytes > m_liveBytes)) {
+        compact();
+    }
+}
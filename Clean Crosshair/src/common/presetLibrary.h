@@ -0,0 +1,113 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <map>
+#include <cstdint>
+#include <cstddef>
+#include "mappedFile.h"
+
+// All presets in one file, read through a memory mapping. A compacted index at
+// the front maps names to payloads (binary presets, see presetFormat.h); saves
+// and deletes are appended as records after the payloads and folded into a new
+// index when the file is compacted.
+//
+// Layout, all integers little-endian:
+//    0  char[4]  magic "CCLB"
+//    4  uint16   version
+//    6  uint16   reserved, 0
+//    8  uint32   index entry count
+//   12  uint32   index size in bytes
+//   16  uint64   offset of the first appended record
+//   24  index entries: uint64 payload offset, uint32 payload size,
+//       uint32 CRC-32 of the payload, uint64 content hash, uint32 width,
+//       uint32 height, uint16 name length, name
+//       payloads
+//       records: uint8 type (PresetRecord), uint32 payload size, uint32 CRC-32,
+//       uint64 content hash, uint32 width, uint32 height, uint16 name length,
+//       name, payload
+//
+// The content hash is Crosshair::getContentHash() of the stored preset, so
+// identical presets can be found from the index alone.
+//
+// Only the tail can be torn by a crash; an incomplete last record is dropped
+// when the library is opened.
+enum class PresetRecord : uint8_t {
+    Put = 0,
+    Remove = 1
+};
+
+class PresetLibrary {
+public:
+    static constexpr char MAGIC[4] = { 'C', 'C', 'L', 'B' };
+    static constexpr uint16_t VERSION = 2;
+    static constexpr size_t HEADER_SIZE = 24;
+    static constexpr size_t INDEX_ENTRY_SIZE = 34;   // without the name
+    static constexpr size_t RECORD_HEADER_SIZE = 27; // without the name
+
+    // Appended records allowed before the file is compacted, and the stale
+    // payload bytes that trigger it early once they outweigh the live ones
+    static constexpr int COMPACT_RECORD_LIMIT = 256;
+    static constexpr size_t COMPACT_MIN_DEAD_BYTES = 256 * 1024;
+
+    struct Entry {
+        uint64_t offset;  // Payload position in the file
+        uint32_t size;
+        uint32_t hash;    // CRC-32 of the payload
+        uint64_t contentHash;
+        uint32_t width;
+        uint32_t height;
+    };
+
+    PresetLibrary();
+
+    // Open a library file, creating an empty one if it does not exist
+    bool open(const std::string& path);
+    void close();
+    bool isOpen() const { return m_map.isOpen(); }
+
+    // Names in sorted order; only the index is read
+    std::vector<std::string> getNames() const;
+
+    // Index entry of a preset, or null if there is none
+    const Entry* find(const std::string& name) const;
+
+    // Binary preset stored under a name (empty if none). The view points into
+    // the mapping and is valid until the next write.
+    std::string_view getPayload(const std::string& name) const;
+
+    // Store a binary preset and its content hash under a name, replacing any
+    // previous one. The payload must not point into this library's mapping.
+    bool put(const std::string& name, std::string_view payload, uint64_t contentHash);
+
+    // Remove a preset, returning false if there was none
+    bool remove(const std::string& name);
+
+    // Rewrite the file with a fresh index and only the live payloads
+    bool compact();
+
+private:
+    std::string m_path;
+    MappedFile m_map;
+    std::map<std::string, Entry> m_entries;
+
+    // End of the last valid record; appends start here
+    uint64_t m_logEnd;
+
+    // Records appended since the last compaction and the payload bytes they
+    // made unreachable
+    int m_logRecords;
+    size_t m_deadBytes;
+    size_t m_liveBytes;
+
+    // Map the file and rebuild the index from it
+    bool load();
+
+    // Append one record at m_logEnd, remapping the file afterwards
+    bool appendRecord(PresetRecord type, const std::string& name, const Entry& entry,
+        std::string_view payload);
+
+    // Compact once enough has been appended
+    void compactIfNeeded();
+};
@@ -0,0 +1,103 @@
+#include "presetSink.h"
+#include <filesystem>
+
+PresetSink::PresetSink()
+    : m_buffer(new char[BUFFER_SIZE]),
+    m_used(0),
+    m_failed(false) {
+}
+
+void PresetSink::put16(uint16_t value) {
+    char bytes[2] = { (char)(value & 0xFF), (char)(value >> 8) };
+    write(bytes, sizeof(bytes));
+}
+
+void PresetSink::put32(uint32_t value) {
+    char bytes[4] = {
+        (char)(value & 0xFF),
+        (char)((value >> 8) & 0xFF),
+        (char)((value >> 16) & 0xFF),
+        (char)(value >> 24)
+    };
+    write(bytes, sizeof(bytes));
+}
+
+void PresetSink::put64(uint64_t value) {
+    put32((uint32_t)value);
+    put32((uint32_t)(value >> 32));
+}
+
+void PresetSink::flush() {
+    if (m_used > 0 && !m_failed) {
+        m_failed = !flushBuffer(m_buffer.get(), m_used);
+    }
+    m_used = 0;
+}
+
+bool PresetSink::finish() {
+    flush();
+    return !m_failed;
+}
+
+void PresetSink::writeLarge(const void* data, size_t length) {
+    flush();
+
+    // Anything that would fill the buffer on its own bypasses it
+    if (length >= BUFFER_SIZE) {
+        if (!m_failed) {
+            m_failed = !flushBuffer((const char*)data, length);
+        }
+        return;
+    }
+
+    std::memcpy(m_buffer.get(), data, length);
+    m_used = length;
+}
+
+bool StringSink::flushBuffer(const char* data, size_t length) {
+    m_out.append(data, length);
+    return true;
+}
+
+FileSink::FileSink(const std::string& path)
+    : m_file(path, std::ios::binary | std::ios::trunc) {
+}
+
+bool FileSink::close() {
+    bool ok = finish();
+    m_file.close();
+    return ok && !m_file.fail();
+}
+
+bool FileSink::flushBuffer(const char* data, size_t length) {
+    m_file.write(data, length);
+    return !m_file.fail();
+}
+
+bool FileSink::writeAtomic(const std::string& path, const std::function<void(PresetSink&)>& write) {
+    std::string tempPath = path + ".tmp";
+
+    {
+        FileSink file(tempPath);
+        if (!file.isOpen()) {
+            return false;
+        }
+
+        write(file);
+
+        if (!file.close()) {
+            std::filesystem::remove(tempPath);
+            return false;
+        }
+    }
+
+    // Replaces the destination in one step
+    std::error_code error;
+    std::filesystem::rename(tempPath, path, error);
+    if (error) {
+        std::filesystem::remove(tempPath, error);
+        return false;
+    }
+
+    return true;
+}
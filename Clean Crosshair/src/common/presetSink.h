@@ -0,0 +1,95 @@
+#pragma once
+
+#include <string>
+#include <fstream>
+#include <memory>
+#include <functional>
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+
+// Byte destination shared by the preset serializers. Writes land in a
+// fixed-size buffer that is handed to flushBuffer() whenever it fills, so a
+// preset streams to its destination without being built in memory first.
+// Call finish() once everything has been written.
+class PresetSink {
+public:
+    static constexpr size_t BUFFER_SIZE = 64 * 1024;
+
+    PresetSink();
+    virtual ~PresetSink() {}
+
+    PresetSink(const PresetSink&) = delete;
+    PresetSink& operator=(const PresetSink&) = delete;
+
+    void put(char c) {
+        if (m_used == BUFFER_SIZE) flush();
+        m_buffer[m_used++] = c;
+    }
+
+    void write(const void* data, size_t length) {
+        if (length > BUFFER_SIZE - m_used) {
+            writeLarge(data, length);
+            return;
+        }
+        std::memcpy(m_buffer.get() + m_used, data, length);
+        m_used += length;
+    }
+
+    // Little-endian integers
+    void put16(uint16_t value);
+    void put32(uint32_t value);
+    void put64(uint64_t value);
+
+    // Hand the buffered bytes to the destination
+    void flush();
+
+    // Flush, returning whether every write reached the destination
+    bool finish();
+
+protected:
+    // Deliver bytes to the destination; returning false fails the sink and
+    // drops everything written after
+    virtual bool flushBuffer(const char* data, size_t length) = 0;
+
+private:
+    std::unique_ptr<char[]> m_buffer;
+    size_t m_used;
+    bool m_failed;
+
+    // Write that does not fit in the space left in the buffer
+    void writeLarge(const void* data, size_t length);
+};
+
+// Appends to a string
+class StringSink : public PresetSink {
+public:
+    explicit StringSink(std::string& out) : m_out(out) {}
+
+protected:
+    bool flushBuffer(const char* data, size_t length) override;
+
+private:
+    std::string& m_out;
+};
+
+// Writes to a file, replacing its contents
+class FileSink : public PresetSink {
+public:
+    explicit FileSink(const std::string& path);
+
+    bool isOpen() const { return m_file.is_open(); }
+
+    // Flush and close the file, returning whether everything was written
+    bool close();
+
+    // Stream write's output to a temporary file and rename it over path, so a
+    // crash never leaves a half-written file behind
+    static bool writeAtomic(const std::string& path, const std::function<void(PresetSink&)>& write);
+
+protected:
+    bool flushBuffer(const char* data, size_t length) override;
+
+private:
+    std::ofstream m_file;
+};
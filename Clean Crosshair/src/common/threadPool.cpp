@@ -0,0 +1,93 @@
+#include "threadPool.h"
+#include <algorithm>
+
+// Set while the thread runs part of a loop
+static thread_local bool t_inLoop = false;
+
+ThreadPool& ThreadPool::getShared() {
+    static ThreadPool pool(std::max(std::thread::hardware_concurrency(), 1u) - 1);
+    return pool;
+}
+
+ThreadPool::ThreadPool(size_t threadCount)
+    : m_stop(false) {
+    for (size_t i = 0; i < threadCount; i++) {
+        m_threads.emplace_back(&ThreadPool::threadMain, this);
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_wake.notify_all();
+    for (std::thread& thread : m_threads) {
+        thread.join();
+    }
+}
+
+void ThreadPool::run(size_t count, const std::function<void(size_t)>& fn) {
+    if (t_inLoop || m_threads.empty() || count < 2) {
+        for (size_t i = 0; i < count; i++) {
+            fn(i);
+        }
+        return;
+    }
+
+    auto loop = std::make_shared<Loop>();
+    loop->fn = &fn;
+    loop->count = count;
+    loop->next = 0;
+    loop->finished = 0;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_loops.push_back(loop);
+    }
+    m_wake.notify_all();
+
+    work(loop);
+
+    // Indices claimed by pool threads may still be running
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_finished.wait(lock, [&] { return loop->finished == count; });
+}
+
+void ThreadPool::work(const std::shared_ptr<Loop>& loop) {
+    t_inLoop = true;
+    size_t finished = 0;
+    for (size_t i = loop->next++; i < loop->count; i = loop->next++) {
+        (*loop->fn)(i);
+        finished++;
+    }
+    t_inLoop = false;
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    // Every index is claimed, so no other thread needs to pick the loop up
+    auto it = std::find(m_loops.begin(), m_loops.end(), loop);
+    if (it != m_loops.end()) {
+        m_loops.erase(it);
+    }
+
+    loop->finished += finished;
+    if (loop->finished == loop->count) {
+        m_finished.notify_all();
+    }
+}
+
+void ThreadPool::threadMain() {
+    std::unique_lock<std::mutex> lock(m_mutex);
+
+    while (true) {
+        m_wake.wait(lock, [this] { return m_stop || !m_loops.empty(); });
+        if (m_stop) {
+            return;
+        }
+
+        std::shared_ptr<Loop> loop = m_loops.front();
+        lock.unlock();
+        work(loop);
+        lock.lock();
+    }
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <vector>
+#include <deque>
+#include <memory>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+
+// Fixed set of threads shared by every parallel loop, so loops running at the
+// same time, or one inside another, never start more threads than the machine
+// has cores. The thread calling run() takes part in its own loop.
+class ThreadPool {
+public:
+    // Pool of one thread less than the machine has cores
+    static ThreadPool& getShared();
+
+    explicit ThreadPool(size_t threadCount);
+
+    // Stops the threads; no loop may still be running
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    // Call fn(i) for every i in [0, count) and return once all have finished.
+    // A loop started from inside another loop's fn runs on the calling thread
+    // alone, since every thread may already be busy with the outer loop.
+    void run(size_t count, const std::function<void(size_t)>& fn);
+
+    // Threads run() can use, counting the caller
+    size_t getThreadCount() const { return m_threads.size() + 1; }
+
+private:
+    struct Loop {
+        const std::function<void(size_t)>* fn;
+        size_t count;
+        std::atomic<size_t> next;
+        size_t finished;  // Guarded by m_mutex
+    };
+
+    std::vector<std::thread> m_threads;
+    std::mutex m_mutex;
+    std::condition_variable m_wake;
+    std::condition_variable m_finished;
+    std::deque<std::shared_ptr<Loop>> m_loops;
+    bool m_stop;
+
+    // Claim and run indices of a loop until none are left
+    void work(const std::shared_ptr<Loop>& loop);
+
+    // Pool thread loop
+    void threadMain();
+};
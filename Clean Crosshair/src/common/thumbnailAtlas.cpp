@@ -0,0 +1,133 @@
+#include "thumbnailAtlas.h"
+#include <algorithm>
+#include <cstring>
+
+// ImGui compiles its own private copy; this one is private to this file
+#define STB_RECT_PACK_IMPLEMENTATION
+#define STBRP_STATIC
+#include <../ext/ImGui/imstb_rectpack.h>
+
+// Empty texels left between thumbnails so scaled draws never sample a neighbor
+static constexpr int THUMBNAIL_PADDING = 1;
+
+ThumbnailAtlas::ThumbnailAtlas()
+    : m_pixels((size_t)ATLAS_SIZE * ATLAS_SIZE, 0),
+    m_packer(std::make_unique<stbrp_context>()),
+    m_packerNodes(ATLAS_SIZE),
+    m_generation(0),
+    m_drawing(false) {
+    reset();
+}
+
+ThumbnailAtlas::~ThumbnailAtlas() {
+}
+
+int ThumbnailAtlas::render(int size, const uint32_t* pixels, std::vector<uint32_t>& thumbnail) {
+    int factor = (size + THUMBNAIL_SIZE - 1) / THUMBNAIL_SIZE;
+    int thumbnailSize = (size + factor - 1) / factor;
+    thumbnail.assign((size_t)thumbnailSize * thumbnailSize, 0);
+
+    for (int ty = 0; ty < thumbnailSize; ty++) {
+        for (int tx = 0; tx < thumbnailSize; tx++) {
+            // Alpha-weighted average, so transparent pixels do not darken edges
+            uint32_t r = 0, g = 0, b = 0, a = 0, count = 0;
+            for (int y = ty * factor; y < std::min((ty + 1) * factor, size); y++) {
+                for (int x = tx * factor; x < std::min((tx + 1) * factor, size); x++) {
+                    Color color = Color::fromImU32(pixels[(size_t)y * size + x]);
+                    r += color.r * color.a;
+                    g += color.g * color.a;
+                    b += color.b * color.a;
+                    a += color.a;
+                    count++;
+                }
+            }
+
+            uint8_t alpha = (uint8_t)(a / count);
+            if (alpha == 0) continue;
+
+            thumbnail[(size_t)ty * thumbnailSize + tx] =
+                Color((uint8_t)(r / a), (uint8_t)(g / a), (uint8_t)(b / a), alpha).toImU32();
+        }
+    }
+
+    return thumbnailSize;
+}
+
+bool ThumbnailAtlas::add(uint64_t hash, int size, const uint32_t* pixels) {
+    if (size <= 0 || size > THUMBNAIL_SIZE) return false;
+    if (m_regions.count(hash)) return true;
+
+    stbrp_rect rect = {};
+    rect.w = size + THUMBNAIL_PADDING;
+    rect.h = size + THUMBNAIL_PADDING;
+    if (!stbrp_pack_rects(m_packer.get(), &rect, 1)) {
+        reset();
+        m_generation++;
+        if (!stbrp_pack_rects(m_packer.get(), &rect, 1)) {
+            return false;
+        }
+    }
+
+    for (int y = 0; y < size; y++) {
+        std::memcpy(&m_pixels[(size_t)(rect.y + y) * ATLAS_SIZE + rect.x], pixels + (size_t)y * size,
+            size * sizeof(uint32_t));
+    }
+
+    m_regions[hash] = { rect.x, rect.y, size };
+    m_dirty.include(PixelRect(rect.x, rect.y, rect.x + size, rect.y + size));
+    return true;
+}
+
+const ThumbnailAtlas::Region* ThumbnailAtlas::find(uint64_t hash) const {
+    auto it = m_regions.find(hash);
+    return it != m_regions.end() ? &it->second : nullptr;
+}
+
+void ThumbnailAtlas::setTexture(std::shared_ptr<PixelTexture> texture) {
+    m_texture = texture;
+
+    // A new texture starts out empty
+    m_dirty = PixelRect(0, 0, ATLAS_SIZE, ATLAS_SIZE);
+}
+
+bool ThumbnailAtlas::beginDraw(ImDrawList* drawList) {
+    if (!m_texture) return false;
+
+    if (m_texture->getWidth() != ATLAS_SIZE || m_texture->getHeight() != ATLAS_SIZE) {
+        m_dirty = PixelRect(0, 0, ATLAS_SIZE, ATLAS_SIZE);
+    }
+
+    if (!m_dirty.isEmpty()) {
+        if (!m_texture->upload(ATLAS_SIZE, ATLAS_SIZE, m_dirty.minX, m_dirty.minY, m_dirty.width(), m_dirty.height(),
+            &m_pixels[(size_t)m_dirty.minY * ATLAS_SIZE + m_dirty.minX], ATLAS_SIZE)) {
+            return false;
+        }
+        m_dirty = PixelRect();
+    }
+
+    m_texture->beginRegions(drawList);
+    m_drawing = true;
+    return true;
+}
+
+void ThumbnailAtlas::draw(ImDrawList* drawList, const Region& region, float minX, float minY, float maxX, float maxY) {
+    if (!m_drawing) return;
+
+    m_texture->addRegion(drawList, minX, minY, maxX, maxY, region.x, region.y, region.size, region.size);
+}
+
+void ThumbnailAtlas::endDraw(ImDrawList* drawList) {
+    if (!m_drawing) return;
+
+    m_texture->endRegions(drawList);
+    m_drawing = false;
+}
+
+void ThumbnailAtlas::reset() {
+    stbrp_init_target(m_packer.get(), ATLAS_SIZE, ATLAS_SIZE, m_packerNodes.data(), (int)m_packerNodes.size());
+    m_regions.clear();
+
+    // Clear old thumbnails too, so padding around new ones is always empty
+    std::fill(m_pixels.begin(), m_pixels.end(), 0);
+    m_dirty = PixelRect(0, 0, ATLAS_SIZE, ATLAS_SIZE);
+}
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <vector>
+#include <unordered_map>
+#include <memory>
+#include <cstdint>
+#include "pixel.h"
+#include "pixelTexture.h"
+
+struct stbrp_context;
+struct stbrp_node;
+
+// Small previews of presets packed into one texture with stb_rect_pack, so a
+// whole list of them draws from a single texture. Thumbnails are keyed by
+// content hash (see contentHash.h); once the atlas is full it is cleared and
+// refilled with whatever is asked for next.
+class ThumbnailAtlas {
+public:
+    static constexpr int ATLAS_SIZE = 512;
+    static constexpr int THUMBNAIL_SIZE = 32;
+
+    // Where a thumbnail sits in the atlas
+    struct Region {
+        int x, y;
+        int size;
+    };
+
+    ThumbnailAtlas();
+    ~ThumbnailAtlas();
+
+    ThumbnailAtlas(const ThumbnailAtlas&) = delete;
+    ThumbnailAtlas& operator=(const ThumbnailAtlas&) = delete;
+
+    // Shrink a size x size grid to at most THUMBNAIL_SIZE square by averaging
+    // blocks of pixels, returning the thumbnail's size. Touches no atlas
+    // state, so it can run on any thread.
+    static int render(int size, const uint32_t* pixels, std::vector<uint32_t>& thumbnail);
+
+    // Place a thumbnail, clearing the atlas first if it is full. Returns false
+    // if the thumbnail is larger than THUMBNAIL_SIZE.
+    bool add(uint64_t hash, int size, const uint32_t* pixels);
+
+    // Region of a thumbnail, or null if it is not in the atlas
+    const Region* find(uint64_t hash) const;
+
+    // Bumped every time the atlas is cleared to make room
+    unsigned getGeneration() const { return m_generation; }
+
+    void setTexture(std::shared_ptr<PixelTexture> texture);
+
+    // Thumbnails are drawn between beginDraw and endDraw, which upload
+    // anything added since the last frame and switch to point sampling once
+    // for all of them. beginDraw returns false if there is nothing to draw from.
+    bool beginDraw(ImDrawList* drawList);
+    void draw(ImDrawList* drawList, const Region& region, float minX, float minY, float maxX, float maxY);
+    void endDraw(ImDrawList* drawList);
+
+private:
+    // ATLAS_SIZE x ATLAS_SIZE packed pixels
+    std::vector<uint32_t> m_pixels;
+    std::unordered_map<uint64_t, Region> m_regions;
+
+    std::unique_ptr<stbrp_context> m_packer;
+    std::vector<stbrp_node> m_packerNodes;
+
+    // Part of m_pixels not yet uploaded
+    PixelRect m_dirty;
+    unsigned m_generation;
+
+    // Between a successful beginDraw and endDraw
+    bool m_drawing;
+
+    std::shared_ptr<PixelTexture> m_texture;
+
+    // Empty the atlas and start packing from scratch
+    void reset();
+};
@@ -3,6 +3,30 @@
 #include <algorithm>
 #include <cmath>
 
+// Checkerboard shown through transparent cells
+static constexpr uint32_t CHECKER_LIGHT = IM_COL32(50, 50, 50, 255);
+static constexpr uint32_t CHECKER_DARK = IM_COL32(30, 30, 30, 255);
+static constexpr uint32_t GRID_LINE_COLOR = IM_COL32(60, 60, 60, 255);
+
+static uint32_t checkerColor(int x, int y) {
+    return (x + y) % 2 == 0 ? CHECKER_LIGHT : CHECKER_DARK;
+}
+
+// Blend a packed pixel over the opaque background behind it
+static uint32_t blendOver(uint32_t color, uint32_t background) {
+    uint32_t alpha = packedAlpha(color);
+    if (alpha == 255) return color;
+    if (alpha == 0) return background;
+
+    uint32_t result = 0xFF000000;
+    for (int shift = 0; shift < 24; shift += 8) {
+        uint32_t c = (color >> shift) & 0xFF;
+        uint32_t b = (background >> shift) & 0xFF;
+        result |= ((c * alpha + b * (255 - alpha) + 127) / 255) << shift;
+    }
+    return result;
+}
+
 CrosshairEditor::CrosshairEditor()
     : m_drawColor(255, 255, 255, 255)
     , m_currentTool(Tool::Pencil)
@@ -11,7 +35,10 @@ CrosshairEditor::CrosshairEditor()
     , m_startX(0)
     , m_startY(0)
     , m_endX(0)
-    , m_endY(0) {
+    , m_endY(0)
+    , m_lastEditGeneration(0)
+    , m_historyGeneration(0)
+    , m_canvasGeneration(0) {
 }
 
 CrosshairEditor::~CrosshairEditor() {
@@ -19,6 +46,125 @@ CrosshairEditor::~CrosshairEditor() {
 
 void CrosshairEditor::initialize(std::shared_ptr<Crosshair> crosshair) {
     m_crosshair = crosshair;
+    resetHistory();
+}
+
+void CrosshairEditor::resetHistory() {
+    if (!m_crosshair) return;
+
+    // A stroke in progress belonged to the old pixels
+    m_isDrawing = false;
+    m_history.reset(*m_crosshair);
+    m_historyGeneration = m_crosshair->getGeneration();
+}
+
+void CrosshairEditor::setCanvasTexture(std::shared_ptr<PixelTexture> texture) {
+    m_canvasTexture = texture;
+    m_canvasGeneration = 0;
+}
+
+bool CrosshairEditor::updateCanvas() {
+    int gridSize = m_crosshair->getSize();
+    uint64_t generation = m_crosshair->getGeneration();
+    bool resized = m_canvasTexture->getWidth() != gridSize || m_canvasTexture->getHeight() != gridSize;
+    if (!resized && generation == m_canvasGeneration) return true;
+
+    // Only what changed since the last upload, unless the texture is new
+    PixelRect dirty = resized ? PixelRect(0, 0, gridSize, gridSize) : m_crosshair->getDirtyRect(m_canvasGeneration);
+    dirty = PixelRect(std::max(dirty.minX, 0), std::max(dirty.minY, 0),
+        std::min(dirty.maxX, gridSize), std::min(dirty.maxY, gridSize));
+    if (dirty.isEmpty()) {
+        dirty = PixelRect();
+    }
+
+    // Composite the dirty rectangle over the checkerboard
+    int width = dirty.width();
+    m_canvasBuffer.resize((size_t)width * dirty.height());
+    m_rowScratch.resize(gridSize);
+    uint32_t* out = m_canvasBuffer.data();
+    for (int y = dirty.minY; y < dirty.maxY; y++) {
+        std::span<const uint32_t> row = m_crosshair->getRow(y, dirty.minX, width, m_rowScratch.data());
+        for (int x = dirty.minX; x < dirty.maxX; x++) {
+            *out++ = blendOver(row[x - dirty.minX], checkerColor(x, y));
+        }
+    }
+
+    if (!m_canvasTexture->upload(gridSize, gridSize, dirty.minX, dirty.minY, width, dirty.height(),
+        m_canvasBuffer.data(), width)) {
+        return false;
+    }
+
+    m_canvasGeneration = generation;
+    return true;
+}
+
+void CrosshairEditor::drawCells(ImDrawList* drawList, float startX, float startY, float cellSize) {
+    int gridSize = m_crosshair->getSize();
+
+    // Rows outside the opaque bounds are known to be transparent
+    PixelRect bounds = m_crosshair->getOpaqueBounds();
+    m_rowScratch.resize(gridSize);
+
+    for (int y = 0; y < gridSize; y++) {
+        float cellY = startY + y * cellSize;
+
+        // Draw cell backgrounds (checkerboard pattern for transparency)
+        for (int x = 0; x < gridSize; x++) {
+            ImVec2 cellMin(startX + x * cellSize, cellY);
+            drawList->AddRectFilled(cellMin, ImVec2(cellMin.x + cellSize, cellY + cellSize), checkerColor(x, y));
+        }
+
+        // Draw the opaque runs; packed pixels are ImU32 colors already
+        if (y >= bounds.minY && y < bounds.maxY) {
+            m_crosshair->forEachOpaqueSpan(y, [&](int spanStart, int spanEnd) {
+                std::span<const uint32_t> row = m_crosshair->getRow(y, spanStart, spanEnd - spanStart, m_rowScratch.data());
+                float cellX = startX + spanStart * cellSize;
+                for (uint32_t color : row) {
+                    drawList->AddRectFilled(ImVec2(cellX, cellY), ImVec2(cellX + cellSize, cellY + cellSize), color);
+                    cellX += cellSize;
+                }
+            });
+        }
+    }
+}
+
+void CrosshairEditor::recordHistory() {
+    if (!m_crosshair) return;
+
+    uint64_t generation = m_crosshair->getGeneration();
+    if (generation == m_historyGeneration) return;
+
+    m_history.record(*m_crosshair, m_crosshair->getDirtyRect(m_historyGeneration));
+    m_historyGeneration = generation;
+}
+
+bool CrosshairEditor::undo() {
+    endEdit();
+    return m_history.canUndo() && jumpToHistory(m_history.getPosition() - 1);
+}
+
+bool CrosshairEditor::redo() {
+    endEdit();
+    return m_history.canRedo() && jumpToHistory(m_history.getPosition() + 1);
+}
+
+void CrosshairEditor::endEdit() {
+    // Changes not recorded yet become their own entry, and a stroke in
+    // progress ends here
+    m_isDrawing = false;
+    recordHistory();
+}
+
+bool CrosshairEditor::jumpToHistory(size_t position) {
+    if (!m_crosshair) return false;
+
+    endEdit();
+    if (position > m_history.getCount() || !m_history.jumpTo(position, *m_crosshair)) {
+        return false;
+    }
+
+    m_historyGeneration = m_crosshair->getGeneration();
+    return true;
 }
 
 void CrosshairEditor::render() {
@@ -48,31 +194,28 @@ void CrosshairEditor::render() {
     // Draw grid background
     ImDrawList* drawList = ImGui::GetWindowDrawList();
     ImVec2 gridStart = ImGui::GetCursorScreenPos();
+    ImVec2 gridEnd(gridStart.x + gridSize * cellSize, gridStart.y + gridSize * cellSize);
 
-    // Draw grid cells
-    for (int y = 0; y < gridSize; y++) {
-        for (int x = 0; x < gridSize; x++) {
-            Color color = m_crosshair->getPixel(x, y);
-
-            // Calculate cell bounds
-            ImVec2 cellMin(gridStart.x + x * cellSize, gridStart.y + y * cellSize);
-            ImVec2 cellMax(cellMin.x + cellSize, cellMin.y + cellSize);
-
-            // Draw cell background (checkerboard pattern for transparency)
-            bool isCheckered = (x + y) % 2 == 0;
-            ImU32 bgColor = isCheckered ? IM_COL32(50, 50, 50, 255) : IM_COL32(30, 30, 30, 255);
-            drawList->AddRectFilled(cellMin, cellMax, bgColor);
-
-            // Draw pixel color if not transparent
-            if (color.a > 0) {
-                drawList->AddRectFilled(cellMin, cellMax, IM_COL32(color.r, color.g, color.b, color.a));
-            }
+    // Cells come from the canvas texture, one texel each
+    if (m_canvasTexture && updateCanvas()) {
+        m_canvasTexture->draw(drawList, gridStart.x, gridStart.y, gridEnd.x, gridEnd.y);
+    }
+    else {
+        drawCells(drawList, gridStart.x, gridStart.y, cellSize);
+    }
 
-            // Draw cell border
-            drawList->AddRect(cellMin, cellMax, IM_COL32(60, 60, 60, 255));
-        }
+    // Cell borders, one line per grid line rather than a rectangle per cell
+    for (int i = 0; i <= gridSize; i++) {
+        float x = gridStart.x + i * cellSize;
+        float y = gridStart.y + i * cellSize;
+        drawList->AddLine(ImVec2(x, gridStart.y), ImVec2(x, gridEnd.y), GRID_LINE_COLOR);
+        drawList->AddLine(ImVec2(gridStart.x, y), ImVec2(gridEnd.x, y), GRID_LINE_COLOR);
     }
 
+    // Tool writes this frame are published as a single change
+    uint64_t generation = m_crosshair->getGeneration();
+    m_crosshair->beginBatch();
+
     // Handle mouse input for drawing
     if (ImGui::IsMouseHoveringRect(gridStart, ImVec2(gridStart.x + gridSize * cellSize, gridStart.y + gridSize * cellSize))) {
         // Show cursor position
@@ -95,14 +238,7 @@ void CrosshairEditor::render() {
                 }
                 else {
                     // Eraser sets transparent pixels
-                    Color transparent(0, 0, 0, 0);
-                    for (int y = mouseGridY - m_brushSize / 2; y <= mouseGridY + m_brushSize / 2; y++) {
-                        for (int x = mouseGridX - m_brushSize / 2; x <= mouseGridX + m_brushSize / 2; x++) {
-                            if (x >= 0 && x < gridSize && y >= 0 && y < gridSize) {
-                                m_crosshair->setPixel(x, y, transparent);
-                            }
-                        }
-                    }
+                    fillBrush(mouseGridX, mouseGridY, mouseGridX, mouseGridY, Color(0, 0, 0, 0));
                 }
             }
             else if (m_currentTool == Tool::ColorPicker) {
@@ -110,6 +246,13 @@ void CrosshairEditor::render() {
                     m_drawColor = m_crosshair->getPixel(mouseGridX, mouseGridY);
                 }
             }
+            else if (m_currentTool == Tool::Recolor) {
+                // Replace every pixel of the clicked color with the draw color
+                Color target = m_crosshair->getPixel(mouseGridX, mouseGridY);
+                if (target.a > 0) {
+                    m_crosshair->replaceColor(target, m_drawColor);
+                }
+            }
         }
         else if (ImGui::IsMouseDown(ImGuiMouseButton_Left) && m_isDrawing) {
             m_endX = mouseGridX;
@@ -122,14 +265,7 @@ void CrosshairEditor::render() {
                 m_startY = m_endY;
             }
             else if (m_currentTool == Tool::Eraser) {
-                Color transparent(0, 0, 0, 0);
-                for (int y = mouseGridY - m_brushSize / 2; y <= mouseGridY + m_brushSize / 2; y++) {
-                    for (int x = mouseGridX - m_brushSize / 2; x <= mouseGridX + m_brushSize / 2; x++) {
-                        if (x >= 0 && x < gridSize && y >= 0 && y < gridSize) {
-                            m_crosshair->setPixel(x, y, transparent);
-                        }
-                    }
-                }
+                fillBrush(mouseGridX, mouseGridY, mouseGridX, mouseGridY, Color(0, 0, 0, 0));
                 m_startX = m_endX;
                 m_startY = m_endY;
             }
@@ -163,6 +299,16 @@ void CrosshairEditor::render() {
         }
     }
 
+    m_crosshair->commitBatch();
+    if (m_crosshair->getGeneration() != generation) {
+        m_lastEditGeneration = m_crosshair->getGeneration();
+    }
+
+    // A stroke is one history entry, recorded once the mouse is released
+    if (!m_isDrawing || !ImGui::IsMouseDown(ImGuiMouseButton_Left)) {
+        recordHistory();
+    }
+
     // Draw preview of shape being drawn
     if (m_isDrawing) {
         ImVec2 start(gridStart.x + m_startX * cellSize, gridStart.y + m_startY * cellSize);
@@ -202,19 +348,23 @@ void CrosshairEditor::handleMouseInput(int x, int y, bool leftButton, bool right
 }
 
 void CrosshairEditor::drawPixel(int x, int y) {
+    fillBrush(x, y, x, y, m_drawColor);
+}
+
+void CrosshairEditor::fillBrush(int x1, int y1, int x2, int y2, const Color& color) {
     if (!m_crosshair) return;
 
+    // Only brush centers inside the grid paint
     int gridSize = m_crosshair->getSize();
-    if (x < 0 || x >= gridSize || y < 0 || y >= gridSize) return;
-
-    // Draw a pixel with the current brush size
-    for (int by = y - m_brushSize / 2; by <= y + m_brushSize / 2; by++) {
-        for (int bx = x - m_brushSize / 2; bx <= x + m_brushSize / 2; bx++) {
-            if (bx >= 0 && bx < gridSize && by >= 0 && by < gridSize) {
-                m_crosshair->setPixel(bx, by, m_drawColor);
-            }
-        }
-    }
+    x1 = std::max(x1, 0);
+    y1 = std::max(y1, 0);
+    x2 = std::min(x2, gridSize - 1);
+    y2 = std::min(y2, gridSize - 1);
+    if (x1 > x2 || y1 > y2) return;
+
+    // The brush stamped at every center covers one rectangle
+    int radius = m_brushSize / 2;
+    m_crosshair->fillRect(PixelRect(x1 - radius, y1 - radius, x2 + radius + 1, y2 + radius + 1), color);
 }
 
 void CrosshairEditor::drawLine(int x1, int y1, int x2, int y2) {
@@ -253,11 +403,7 @@ void CrosshairEditor::drawRectangle(int x1, int y1, int x2, int y2, bool filled)
 
     if (filled) {
         // Fill the rectangle
-        for (int y = y1; y <= y2; y++) {
-            for (int x = x1; x <= x2; x++) {
-                drawPixel(x, y);
-            }
-        }
+        fillBrush(x1, y1, x2, y2, m_drawColor);
     }
     else {
         // Draw the outline
@@ -283,15 +429,13 @@ void CrosshairEditor::drawCircle(int x1, int y1, int x2, int y2, bool filled) {
     int radius = std::max(radiusX, radiusY);
 
     if (filled) {
-        // Fill the circle using distance check
+        // Fill the circle one row span at a time
         for (int y = centerY - radius; y <= centerY + radius; y++) {
-            for (int x = centerX - radius; x <= centerX + radius; x++) {
-                int dx = x - centerX;
-                int dy = y - centerY;
-                if (dx * dx + dy * dy <= radius * radius) {
-                    drawPixel(x, y);
-                }
-            }
+            int dy = y - centerY;
+            int dx = (int)std::sqrt((double)(radius * radius - dy * dy));
+            while (dx * dx + dy * dy > radius * radius) dx--;
+            while ((dx + 1) * (dx + 1) + dy * dy <= radius * radius) dx++;
+            fillBrush(centerX - dx, y, centerX + dx, y, m_drawColor);
         }
     }
     else {
@@ -4,6 +4,8 @@
 #include <string>
 #include <vector>
 #include "../common/crosshair.h"
+#include "../common/pixelTexture.h"
+#include "editHistory.h"
 
 class CrosshairEditor {
 public:
@@ -16,6 +18,11 @@ public:
     // Render the crosshair editor UI
     void render();
 
+    // Texture the grid is drawn from, updated only where the pixels change.
+    // Without one every cell is drawn as rectangles; release it with null
+    // before the renderer goes away.
+    void setCanvasTexture(std::shared_ptr<PixelTexture> texture);
+
     // Handle mouse input for editing
     void handleMouseInput(int x, int y, bool leftButton, bool rightButton);
 
@@ -34,12 +41,16 @@ public:
         FilledRectangle,
         Circle,
         FilledCircle,
-        ColorPicker
+        ColorPicker,
+        Recolor
     };
 
     void setTool(Tool tool) { m_currentTool = tool; }
     Tool getTool() const { return m_currentTool; }
 
+    // Crosshair generation after the last change made with a tool
+    uint64_t getLastEditGeneration() const { return m_lastEditGeneration; }
+
     // Set brush size
     void setBrushSize(int size) { m_brushSize = size; }
     int getBrushSize() const { return m_brushSize; }
@@ -47,6 +58,19 @@ public:
     // Clear the crosshair
     void clear();
 
+    // Step through the edit history. Changes made since the last entry,
+    // by the editor or not, are recorded as an entry first.
+    bool undo();
+    bool redo();
+    bool jumpToHistory(size_t position);
+
+    // Start the history over from the crosshair as it is now, after pixels
+    // that are not edits of the old ones (another preset) were loaded into it
+    void resetHistory();
+
+    const EditHistory& getHistory() const { return m_history; }
+    void setHistoryBudget(size_t bytes) { m_history.setBudget(bytes); }
+
     // Preview the result
     void previewResult();
 
@@ -62,9 +86,36 @@ private:
     int m_startY;
     int m_endX;
     int m_endY;
+    uint64_t m_lastEditGeneration;
+
+    // Undo history and the crosshair generation it was last brought up to
+    EditHistory m_history;
+    uint64_t m_historyGeneration;
+
+    // Decode buffer for grid rows that are not stored contiguously
+    std::vector<uint32_t> m_rowScratch;
+
+    // Grid composited over the checkerboard, and the generation it was last
+    // uploaded for
+    std::shared_ptr<PixelTexture> m_canvasTexture;
+    uint64_t m_canvasGeneration;
+    std::vector<uint32_t> m_canvasBuffer;
+
+    // Upload the canvas texture's dirty region; false if it cannot be drawn
+    bool updateCanvas();
+
+    // Draw every cell as rectangles, for when there is no canvas texture
+    void drawCells(ImDrawList* drawList, float startX, float startY, float cellSize);
+
+    // Record changes since the last history entry as a new entry
+    void recordHistory();
+
+    // Finish the stroke in progress and record everything up to now
+    void endEdit();
 
     // Helper drawing functions
     void drawPixel(int x, int y);
+    void fillBrush(int x1, int y1, int x2, int y2, const Color& color);
     void drawLine(int x1, int y1, int x2, int y2);
     void drawRectangle(int x1, int y1, int x2, int y2, bool filled);
     void drawCircle(int x1, int y1, int x2, int y2, bool filled);
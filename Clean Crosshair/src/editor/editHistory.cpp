@@ -0,0 +1,280 @@
+#include "editHistory.h"
+#include "../common/crosshair.h"
+#include <algorithm>
+#include <cstring>
+
+// Run: uint16 count, uint32 packed pixel
+static constexpr size_t RUN_SIZE = 6;
+
+// Runs covering a region of a row-major grid, row by row. Runs continue
+// across rows, so a flat region is a handful of bytes.
+static std::string encodeRuns(const uint32_t* grid, int stride, const PixelRect& rect) {
+    std::string runs;
+    uint32_t runColor = 0;
+    uint16_t runLength = 0;
+
+    auto flush = [&]() {
+        char bytes[RUN_SIZE];
+        std::memcpy(bytes, &runLength, sizeof(runLength));
+        std::memcpy(bytes + 2, &runColor, sizeof(runColor));
+        runs.append(bytes, RUN_SIZE);
+    };
+
+    for (int y = rect.minY; y < rect.maxY; y++) {
+        const uint32_t* row = grid + (size_t)y * stride;
+        for (int x = rect.minX; x < rect.maxX; x++) {
+            if (runLength > 0 && (row[x] != runColor || runLength == UINT16_MAX)) {
+                flush();
+                runLength = 0;
+            }
+            runColor = row[x];
+            runLength++;
+        }
+    }
+    if (runLength > 0) {
+        flush();
+    }
+
+    return runs;
+}
+
+// Write runs made by encodeRuns() back over the same region
+static void decodeRuns(const std::string& runs, uint32_t* grid, int stride, const PixelRect& rect) {
+    int x = rect.minX;
+    int y = rect.minY;
+    for (size_t offset = 0; offset + RUN_SIZE <= runs.size() && y < rect.maxY; offset += RUN_SIZE) {
+        uint16_t count;
+        uint32_t color;
+        std::memcpy(&count, runs.data() + offset, sizeof(count));
+        std::memcpy(&color, runs.data() + offset + 2, sizeof(color));
+
+        while (count > 0 && y < rect.maxY) {
+            int span = std::min<int>(count, rect.maxX - x);
+            std::fill_n(grid + (size_t)y * stride + x, span, color);
+            count -= (uint16_t)span;
+            x += span;
+            if (x == rect.maxX) {
+                x = rect.minX;
+                y++;
+            }
+        }
+    }
+}
+
+static PixelRect wholeGrid(int size) {
+    return PixelRect(0, 0, size, size);
+}
+
+PixelRect EditHistory::Entry::getBeforeRect() const {
+    return beforeSize == afterSize ? rect : wholeGrid(beforeSize);
+}
+
+PixelRect EditHistory::Entry::getAfterRect() const {
+    return beforeSize == afterSize ? rect : wholeGrid(afterSize);
+}
+
+EditHistory::EditHistory()
+    : m_position(0),
+    m_dropped(0),
+    m_budget(DEFAULT_BUDGET),
+    m_bytes(0),
+    m_size(0) {
+}
+
+void EditHistory::reset(const Crosshair& crosshair) {
+    m_entries.clear();
+    m_position = 0;
+    m_dropped = 0;
+    m_bytes = 0;
+
+    // Read into the existing copy, so a preset switch does not allocate
+    m_size = crosshair.getSize();
+    m_pixels.resize((size_t)m_size * m_size);
+    for (int y = 0; y < m_size; y++) {
+        uint32_t* row = m_pixels.data() + (size_t)y * m_size;
+        std::span<const uint32_t> view = crosshair.getRow(y, 0, m_size, row);
+        if (view.data() != row) {
+            std::copy(view.begin(), view.end(), row);
+        }
+    }
+}
+
+bool EditHistory::record(const Crosshair& crosshair, const PixelRect& dirty) {
+    int size = crosshair.getSize();
+
+    Entry entry;
+    entry.beforeSize = m_size;
+    entry.afterSize = size;
+
+    if (size != m_size) {
+        entry.before = encodeRuns(m_pixels.data(), m_size, wholeGrid(m_size));
+        m_pixels = crosshair.getPixels();
+        m_size = size;
+        entry.after = encodeRuns(m_pixels.data(), m_size, wholeGrid(m_size));
+    }
+    else {
+        PixelRect region(std::max(dirty.minX, 0), std::max(dirty.minY, 0),
+            std::min(dirty.maxX, size), std::min(dirty.maxY, size));
+        if (region.isEmpty()) return false;
+
+        // Shrink the dirty region to the pixels that really differ
+        PixelRect changed;
+        m_scratch.resize(region.width());
+        for (int y = region.minY; y < region.maxY; y++) {
+            const uint32_t* copy = m_pixels.data() + (size_t)y * size;
+            std::span<const uint32_t> row = crosshair.getRow(y, region.minX, region.width(), m_scratch.data());
+            for (int x = region.minX; x < region.maxX; x++) {
+                if (copy[x] != row[x - region.minX]) {
+                    changed.include(x, y);
+                }
+            }
+        }
+        if (changed.isEmpty()) return false;
+
+        entry.before = encodeRuns(m_pixels.data(), size, changed);
+        m_scratch.resize(changed.width());
+        for (int y = changed.minY; y < changed.maxY; y++) {
+            std::span<const uint32_t> row = crosshair.getRow(y, changed.minX, changed.width(), m_scratch.data());
+            std::copy(row.begin(), row.end(), m_pixels.begin() + (size_t)y * size + changed.minX);
+        }
+
+        entry.rect = changed;
+        entry.after = encodeRuns(m_pixels.data(), size, changed);
+    }
+
+    // A new edit replaces whatever was undone
+    while (m_entries.size() > m_position) {
+        m_bytes -= m_entries.back().getBytes();
+        m_entries.pop_back();
+    }
+
+    if ((m_dropped + m_entries.size() + 1) % KEYFRAME_INTERVAL == 0) {
+        entry.keyframe = encodeRuns(m_pixels.data(), m_size, wholeGrid(m_size));
+    }
+
+    m_bytes += entry.getBytes();
+    m_entries.push_back(std::move(entry));
+    m_position = m_entries.size();
+
+    trim();
+    return true;
+}
+
+bool EditHistory::undo(Crosshair& crosshair) {
+    return canUndo() && jumpTo(m_position - 1, crosshair);
+}
+
+bool EditHistory::redo(Crosshair& crosshair) {
+    return canRedo() && jumpTo(m_position + 1, crosshair);
+}
+
+bool EditHistory::jumpTo(size_t position, Crosshair& crosshair) {
+    if (position > m_entries.size()) return false;
+
+    // Steps from the current state, or from a keyframe on either side of the
+    // target, counting the keyframe load as one
+    size_t steps = position > m_position ? position - m_position : m_position - position;
+    size_t keyframe = SIZE_MAX;
+    for (size_t i = position; i > 0 && position - i < KEYFRAME_INTERVAL; i--) {
+        if (!m_entries[i - 1].keyframe.empty()) {
+            if (position - i + 1 < steps) {
+                steps = position - i + 1;
+                keyframe = i - 1;
+            }
+            break;
+        }
+    }
+    for (size_t i = position; i < m_entries.size() && i - position < KEYFRAME_INTERVAL; i++) {
+        if (!m_entries[i].keyframe.empty()) {
+            if (i + 1 - position + 1 < steps) {
+                keyframe = i;
+            }
+            break;
+        }
+    }
+
+    PixelRect touched;
+    bool resized = false;
+    if (keyframe != SIZE_MAX) {
+        // However the copy is rebuilt, the crosshair differs from it only
+        // where the entries between the two positions changed it
+        for (size_t i = std::min(position, m_position); i < std::max(position, m_position); i++) {
+            const Entry& entry = m_entries[i];
+            resized |= entry.beforeSize != entry.afterSize;
+            touched.include(entry.getAfterRect());
+        }
+        loadKeyframe(keyframe);
+    }
+
+    while (m_position > position) {
+        undoEntry(touched, resized);
+    }
+    while (m_position < position) {
+        redoEntry(touched, resized);
+    }
+
+    sync(crosshair, touched, resized);
+    return true;
+}
+
+void EditHistory::setBudget(size_t bytes) {
+    m_budget = bytes;
+    trim();
+}
+
+void EditHistory::undoEntry(PixelRect& touched, bool& resized) {
+    const Entry& entry = m_entries[--m_position];
+    if (entry.beforeSize != m_size) {
+        m_size = entry.beforeSize;
+        m_pixels.assign((size_t)m_size * m_size, 0);
+        resized = true;
+    }
+
+    PixelRect rect = entry.getBeforeRect();
+    decodeRuns(entry.before, m_pixels.data(), m_size, rect);
+    touched.include(rect);
+}
+
+void EditHistory::redoEntry(PixelRect& touched, bool& resized) {
+    const Entry& entry = m_entries[m_position++];
+    if (entry.afterSize != m_size) {
+        m_size = entry.afterSize;
+        m_pixels.assign((size_t)m_size * m_size, 0);
+        resized = true;
+    }
+
+    PixelRect rect = entry.getAfterRect();
+    decodeRuns(entry.after, m_pixels.data(), m_size, rect);
+    touched.include(rect);
+}
+
+void EditHistory::loadKeyframe(size_t index) {
+    const Entry& entry = m_entries[index];
+    m_size = entry.afterSize;
+    m_pixels.assign((size_t)m_size * m_size, 0);
+    decodeRuns(entry.keyframe, m_pixels.data(), m_size, wholeGrid(m_size));
+    m_position = index + 1;
+}
+
+void EditHistory::sync(Crosshair& crosshair, const PixelRect& touched, bool resized) {
+    PixelRect rect(std::max(touched.minX, 0), std::max(touched.minY, 0),
+        std::min(touched.maxX, m_size), std::min(touched.maxY, m_size));
+
+    // Replacing the whole grid at once beats writing every pixel of it
+    if (resized || crosshair.getSize() != m_size || (rect.width() == m_size && rect.height() == m_size)) {
+        crosshair.assignPixels(m_size, m_pixels);
+        return;
+    }
+    if (rect.isEmpty()) return;
+
+    crosshair.writeRect(rect, m_pixels.data(), m_size);
+}
+
+void EditHistory::trim() {
+    while (m_bytes > m_budget && m_entries.size() > 1 && m_position > 0) {
+        m_bytes -= m_entries.front().getBytes();
+        m_entries.pop_front();
+        m_position--;
+        m_dropped++;
+    }
+}
@@ -0,0 +1,101 @@
+#pragma once
+
+#include <deque>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include "../common/pixel.h"
+
+class Crosshair;
+
+// Undo/redo history of a crosshair. An entry holds only the region one edit
+// changed, before and after, as runs of equal pixels, so a stroke costs what
+// it touched rather than a copy of the grid. Every KEYFRAME_INTERVAL-th entry
+// also keeps the whole grid, so a jump anywhere in the history replays at
+// most that many entries. The oldest entries are dropped to stay within the
+// memory budget.
+//
+// Edits are found by comparing the crosshair with the history's own copy of
+// the grid as of the last entry.
+class EditHistory {
+public:
+    static constexpr size_t KEYFRAME_INTERVAL = 32;
+    static constexpr size_t DEFAULT_BUDGET = 16 * 1024 * 1024;
+
+    EditHistory();
+
+    // Forget every entry and start over from the crosshair as it is now
+    void reset(const Crosshair& crosshair);
+
+    // Record everything that changed since the last entry as one new entry,
+    // looking only inside dirty (the whole grid if its size changed).
+    // Entries that were undone are discarded. False if nothing changed.
+    bool record(const Crosshair& crosshair, const PixelRect& dirty);
+
+    bool canUndo() const { return m_position > 0; }
+    bool canRedo() const { return m_position < m_entries.size(); }
+
+    // Step one entry back or forward, writing the change to the crosshair
+    bool undo(Crosshair& crosshair);
+    bool redo(Crosshair& crosshair);
+
+    // Move to the state after the first position entries, starting from the
+    // nearest keyframe when that is fewer steps away than the current state
+    bool jumpTo(size_t position, Crosshair& crosshair);
+
+    // Entries applied, out of getCount()
+    size_t getPosition() const { return m_position; }
+    size_t getCount() const { return m_entries.size(); }
+
+    // Memory allowed for entries. Only entries that cannot be redone are
+    // dropped, and never the newest one.
+    void setBudget(size_t bytes);
+    size_t getBudget() const { return m_budget; }
+
+    // Bytes held by entries and keyframes
+    size_t getMemoryUsage() const { return m_bytes; }
+
+private:
+    struct Entry {
+        int beforeSize;
+        int afterSize;
+        PixelRect rect;         // Changed region, when the size did not change
+        std::string before;     // Runs of the region before the edit
+        std::string after;      // and after it
+        std::string keyframe;   // Runs of the whole grid after the edit, or empty
+
+        PixelRect getBeforeRect() const;
+        PixelRect getAfterRect() const;
+        size_t getBytes() const { return before.size() + after.size() + keyframe.size() + sizeof(Entry); }
+    };
+
+    std::deque<Entry> m_entries;
+    size_t m_position;
+
+    // Entries dropped from the front, so keyframes stay KEYFRAME_INTERVAL
+    // apart as the history is trimmed
+    uint64_t m_dropped;
+
+    size_t m_budget;
+    size_t m_bytes;
+
+    // Grid after the first m_position entries
+    int m_size;
+    std::vector<uint32_t> m_pixels;
+    std::vector<uint32_t> m_scratch;
+
+    // Apply one entry's before or after state to the copy of the grid,
+    // adding what changed to touched
+    void undoEntry(PixelRect& touched, bool& resized);
+    void redoEntry(PixelRect& touched, bool& resized);
+
+    // Load a keyframe into the copy of the grid
+    void loadKeyframe(size_t index);
+
+    // Write the touched part of the copy of the grid to the crosshair
+    void sync(Crosshair& crosshair, const PixelRect& touched, bool resized);
+
+    // Drop the oldest entries until the history fits its budget
+    void trim();
+};
@@ -1,14 +1,63 @@
 #include "editorWindow.h"
+#include "../common/threadPool.h"
 #include <../ext/ImGui/imgui.h>
 #include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <utility>
+
+using PreparedList = std::vector<std::pair<uint64_t, std::shared_ptr<Crosshair>>>;
+
+// Build presets into crosshairs on the shared thread pool, in list order
+// until their storage reaches budget bytes. With cachedOnly, presets not in
+// the pixel cache are skipped rather than read, so nothing warmed is evicted.
+static PreparedList preparePresets(FileManager* fileManager, const std::vector<std::string>& names,
+    size_t budget, bool cachedOnly) {
+    PreparedList prepared(names.size());
+    std::atomic<size_t> used = 0;
+
+    ThreadPool::getShared().run(names.size(), [&](size_t i) {
+        if (used >= budget) return;
+
+        std::shared_ptr<const PixelCache::Pixels> pixels = cachedOnly
+            ? fileManager->findCachedPreset(names[i]) : fileManager->readPreset(names[i]);
+        uint64_t hash;
+        if (!pixels || !fileManager->findPresetHash(names[i], hash)) return;
+
+        auto crosshair = std::make_shared<Crosshair>();
+        crosshair->assignPixels(pixels->size, pixels->data);
+        crosshair->getContentHash();
+        used += crosshair->getStorageBytes();
+        prepared[i] = { hash, std::move(crosshair) };
+    });
+
+    std::erase_if(prepared, [](const auto& entry) { return !entry.second; });
+    return prepared;
+}
 
 EditorWindow::EditorWindow()
     : m_visible(false)
     , m_showColorPicker(true)
     , m_showPresets(true)
     , m_showSettings(false)
+    , m_journalGeneration(0)
+    , m_journalBytes(0)
+    , m_journalReady(false)
+    , m_searchText()
+    , m_filteredVersion(0)
+    , m_filterValid(false)
+    , m_currentPresetHash(0)
     , m_currentPreset("Default")
-    , m_newPresetName("") {
+    , m_newPresetName("")
+    , m_opacityPercent(50)
+    , m_showDuplicates(false)
+    , m_libraryEnabled(false)
+    , m_loadSequence(0)
+    , m_lastSwitchMicros(-1)
+    , m_lastSwitchSource("")
+    , m_switchGeneration(0)
+    , m_warmedPresets(0)
+    , m_thumbnailGeneration(0) {
 }
 
 EditorWindow::~EditorWindow() {
@@ -17,24 +66,55 @@ EditorWindow::~EditorWindow() {
 bool EditorWindow::initialize() {
     // Create editor
     m_editor = std::make_unique<CrosshairEditor>();
+    m_editor->setHistoryBudget((size_t)Settings::getInstance().undoHistoryMB * 1024 * 1024);
 
-    // Create file manager
+    // Create file manager and the worker that runs its I/O off the UI thread
     m_fileManager = std::make_unique<FileManager>();
+    m_ioWorker = std::make_unique<IoWorker>();
+    m_warmWorker = std::make_unique<IoWorker>();
+    m_thumbnailWorker = std::make_unique<IoWorker>();
+    m_journalWorker = std::make_unique<IoWorker>();
+    m_fileManager->setPresetCacheBudget((size_t)Settings::getInstance().presetCacheMB * 1024 * 1024);
 
     // Initialize directories
     if (!m_fileManager->initializeDirectories()) {
         return false;
     }
 
-    // Load preset list
-    refreshPresetList();
+    // Presets live either in the library file or one file each; switching
+    // copies whatever the other store has new
+    if (Settings::getInstance().usePresetLibrary) {
+        m_fileManager->setLibraryEnabled(true);
+    }
+
+    m_libraryEnabled = m_fileManager->isLibraryEnabled();
+
+    // Convert presets saved by older versions to the binary format
+    if (!m_libraryEnabled) {
+        m_fileManager->migratePresetsAsync();
+    }
+
+    m_journalPath = m_fileManager->getJournalPath();
+
+    // Pick up presets and settings edited outside the editor
+    m_presetWatcher.start(m_fileManager->getPresetsPath());
+    m_settingsWatcher.start(m_fileManager->getDataPath());
+
+    // Load preset list; nothing is drawn yet, so this one read is synchronous
+    m_presetIndex.assign(m_fileManager->getPresetNames());
+
+    // Thumbnails of presets edited or deleted since are left behind; pruning
+    // is queued first, so no thumbnail is read while it runs
+    FileManager* fileManager = m_fileManager.get();
+    m_thumbnailWorker->submit("prune", [fileManager]() {
+        return fileManager->pruneThumbnails();
+    }, [](int) {});
 
     // If presets are empty, create a default
-    if (m_presets.empty()) {
+    if (m_presetIndex.empty()) {
         if (m_crosshair) {
             m_crosshair->initDefault();
             savePreset("Default");
-            refreshPresetList();
         }
     }
 
@@ -56,18 +136,249 @@ void EditorWindow::setCrosshair(std::shared_ptr<Crosshair> crosshair) {
         m_editor->initialize(crosshair);
     }
 
-    // Try to load the last used preset
+    // Unsaved edits from the last session take the place of the last used
+    // preset
     std::string lastPreset = Settings::getInstance().lastLoadedPreset;
-    if (!lastPreset.empty()) {
-        for (const auto& preset : m_presets) {
-            if (preset == lastPreset) {
-                loadPreset(lastPreset);
-                break;
+    if (!recoverJournal()) {
+        if (!lastPreset.empty() && m_presetIndex.contains(lastPreset)) {
+            loadPreset(lastPreset);
+        } else {
+            resetJournal();
+        }
+    }
+
+    // Runs on its own worker and locks one preset at a time, so loads and
+    // saves only ever wait for the preset being decoded
+    warmPresetCache();
+}
+
+void EditorWindow::update() {
+    if (m_ioWorker) {
+        m_ioWorker->poll();
+        applyFileChanges();
+        Settings::getInstance().update(*m_ioWorker);
+    }
+
+    if (m_warmWorker) {
+        m_warmWorker->poll();
+    }
+
+    if (m_thumbnailWorker) {
+        m_thumbnailWorker->poll();
+    }
+
+    if (m_journalWorker) {
+        journalEdits();
+        m_journalWorker->poll();
+    }
+}
+
+void EditorWindow::applyFileChanges() {
+    static constexpr std::string_view PRESET_EXTENSION = ".crosshair";
+
+    for (const DirectoryWatcher::Event& event : m_presetWatcher.poll()) {
+        // Changes were lost, so read the whole directory again
+        if (event.change == DirectoryWatcher::Change::Overflow) {
+            if (m_libraryEnabled) continue;
+
+            m_fileManager->invalidatePresets();
+            m_thumbnailRequests.clear();
+            m_showDuplicates = false;
+            m_presetIndex.assign(m_fileManager->getPresetNames());
+            if (!m_currentPreset.empty()) {
+                reloadCurrentPreset();
             }
+            continue;
+        }
+
+        // Temporary files of atomic writes are not presets; neither is the
+        // directory while the library is in use
+        std::string_view file = event.name;
+        if (m_libraryEnabled || file.size() <= PRESET_EXTENSION.size() || !file.ends_with(PRESET_EXTENSION)) {
+            continue;
+        }
+
+        std::string name(file.substr(0, file.size() - PRESET_EXTENSION.size()));
+        m_fileManager->invalidatePreset(name);
+        m_thumbnailRequests.erase(name);
+        m_showDuplicates = false;
+
+        if (event.change == DirectoryWatcher::Change::Removed) {
+            m_presetIndex.remove(name);
+            continue;
+        }
+
+        // Added also covers a file replaced by a rename
+        m_presetIndex.insert(name);
+        if (name == m_currentPreset) {
+            reloadCurrentPreset();
+        }
+    }
+
+    for (const DirectoryWatcher::Event& event : m_settingsWatcher.poll()) {
+        if (event.change == DirectoryWatcher::Change::Overflow
+            || (event.name == "settings.cfg" && event.change != DirectoryWatcher::Change::Removed)) {
+            Settings::getInstance().reload();
         }
     }
 }
 
+void EditorWindow::reloadCurrentPreset() {
+    FileManager* fileManager = m_fileManager.get();
+    std::string name = m_currentPreset;
+    uint64_t sequence = m_loadSequence;
+
+    m_ioWorker->submit("reload", [fileManager, name]() {
+        std::shared_ptr<const PixelCache::Pixels> pixels = fileManager->readPreset(name);
+        uint64_t hash = 0;
+        fileManager->findPresetHash(name, hash);
+        return std::make_pair(pixels, hash);
+    }, [this, name, sequence](std::pair<std::shared_ptr<const PixelCache::Pixels>, uint64_t> result) {
+        // Skip our own saves, and presets switched away from in the meantime
+        if (!result.first || result.second == m_currentPresetHash) return;
+        if (sequence != m_loadSequence || name != m_currentPreset) return;
+
+        m_crosshair->assignPixels(result.first->size, result.first->data);
+        m_currentPresetHash = result.second;
+        m_editor->resetHistory();
+        resetJournal();
+    });
+}
+
+void EditorWindow::journalEdits() {
+    if (!m_journalReady || !m_crosshair) return;
+
+    uint64_t generation = m_crosshair->getGeneration();
+    if (generation == m_journalGeneration) return;
+
+    PixelRect dirty = m_crosshair->getDirtyRect(m_journalGeneration);
+    m_journalGeneration = generation;
+
+    // Replaying a long journal costs more than one record of the whole grid
+    if (m_journalBytes >= EditJournal::CHECKPOINT_BYTES) {
+        checkpointJournal();
+        return;
+    }
+
+    uint8_t tool = EditJournal::TOOL_OTHER;
+    if (m_editor && m_editor->getLastEditGeneration() == generation) {
+        tool = (uint8_t)m_editor->getTool();
+    }
+
+    std::string record = EditJournal::encodeRecord(tool, *m_crosshair, dirty);
+    m_journalBytes += record.size();
+
+    EditJournal* journal = &m_journal;
+    m_journalWorker->submit("", [journal, record = std::move(record)]() {
+        return journal->append(record);
+    }, [](bool) {});
+}
+
+void EditorWindow::resetJournal() {
+    if (!m_crosshair || !m_journalWorker) return;
+
+    m_journalGeneration = m_crosshair->getGeneration();
+    m_journalBytes = 0;
+    m_journalReady = true;
+
+    EditJournal* journal = &m_journal;
+    std::string path = m_journalPath;
+    std::string name = m_currentPreset;
+    uint64_t hash = m_currentPresetHash;
+    m_journalWorker->submit("", [journal, path, name, hash]() {
+        return journal->reset(path, name, hash);
+    }, [](bool) {});
+}
+
+void EditorWindow::checkpointJournal() {
+    if (!m_crosshair || !m_journalWorker) return;
+
+    int size = m_crosshair->getSize();
+    std::string record = EditJournal::encodeRecord(EditJournal::TOOL_OTHER, *m_crosshair,
+        PixelRect(0, 0, size, size));
+
+    m_journalGeneration = m_crosshair->getGeneration();
+    m_journalBytes = record.size();
+    m_journalReady = true;
+
+    EditJournal* journal = &m_journal;
+    std::string path = m_journalPath;
+    std::string name = m_currentPreset;
+    uint64_t hash = m_currentPresetHash;
+    m_journalWorker->submit("", [journal, path, name, hash, record = std::move(record)]() {
+        return journal->reset(path, name, hash, record);
+    }, [](bool) {});
+}
+
+bool EditorWindow::recoverJournal() {
+    if (!m_crosshair || !m_fileManager) return false;
+
+    std::string baseName;
+    uint64_t baseHash = 0;
+    std::vector<EditJournal::Record> records;
+    if (!EditJournal::read(m_journalPath, baseName, baseHash, records) || records.empty()) {
+        return false;
+    }
+
+    // Deltas only apply to the preset they were recorded on; a checkpoint
+    // holds the whole grid and needs no base
+    const EditJournal::Record& first = records.front();
+    bool checkpoint = first.rect.minX == 0 && first.rect.minY == 0 &&
+        first.rect.width() == first.gridSize && first.rect.height() == first.gridSize;
+    if (!checkpoint) {
+        uint64_t hash = 0;
+        std::shared_ptr<const PixelCache::Pixels> base = m_fileManager->readPreset(baseName);
+        if (!base || !m_fileManager->findPresetHash(baseName, hash) || hash != baseHash) {
+            return false;
+        }
+        m_crosshair->assignPixels(base->size, base->data);
+    }
+
+    for (const EditJournal::Record& record : records) {
+        EditJournal::apply(record, *m_crosshair);
+    }
+
+    m_currentPreset = baseName;
+    m_currentPresetHash = baseHash;
+    m_editor->resetHistory();
+
+    // The recovered edits are still unsaved; keep them in the new journal
+    checkpointJournal();
+    return true;
+}
+
+void EditorWindow::shutdown() {
+    if (m_ioWorker) {
+        // Let queued writes finish and apply their results first
+        m_ioWorker->wait();
+        m_ioWorker->poll();
+    }
+
+    // The journal is kept on exit, so unsaved edits come back next time
+    if (m_journalWorker) {
+        journalEdits();
+        m_journalWorker->wait();
+        m_journalWorker->poll();
+    }
+
+    Settings::getInstance().flush();
+
+    m_thumbnails.setTexture(nullptr);
+    if (m_editor) {
+        m_editor->setCanvasTexture(nullptr);
+    }
+}
+
+void EditorWindow::setThumbnailTexture(std::shared_ptr<PixelTexture> texture) {
+    m_thumbnails.setTexture(texture);
+}
+
+void EditorWindow::setCanvasTexture(std::shared_ptr<PixelTexture> texture) {
+    if (m_editor) {
+        m_editor->setCanvasTexture(texture);
+    }
+}
+
 void EditorWindow::render() {
     if (!m_visible || !m_crosshair || !m_editor) {
         return;
@@ -75,6 +386,14 @@ void EditorWindow::render() {
 
     ImGui::SetNextWindowSize(ImVec2(800, 600), ImGuiCond_FirstUseEver);
     if (ImGui::Begin("Crosshair Editor", &m_visible)) {
+        // Undo and redo; text fields keep these keys while they are active
+        if (ImGui::Shortcut(ImGuiMod_Ctrl | ImGuiKey_Z)) {
+            m_editor->undo();
+        }
+        if (ImGui::Shortcut(ImGuiMod_Ctrl | ImGuiKey_Y) || ImGui::Shortcut(ImGuiMod_Ctrl | ImGuiMod_Shift | ImGuiKey_Z)) {
+            m_editor->redo();
+        }
+
         // Split into two main columns
         ImGui::Columns(2, nullptr, true);
 
@@ -134,19 +453,64 @@ void EditorWindow::renderToolbar() {
     ImGui::SameLine();
     if (ImGui::Button("Color Picker")) m_editor->setTool(CrosshairEditor::Tool::ColorPicker);
     ImGui::SameLine();
+    if (ImGui::Button("Recolor")) m_editor->setTool(CrosshairEditor::Tool::Recolor);
+    ImGui::SameLine();
     if (ImGui::Button("Clear")) m_editor->clear();
 
+    // Undo history; the slider scrubs through every entry
+    const EditHistory& history = m_editor->getHistory();
+    ImGui::BeginDisabled(!history.canUndo());
+    if (ImGui::Button("Undo")) m_editor->undo();
+    ImGui::EndDisabled();
+    ImGui::SameLine();
+    ImGui::BeginDisabled(!history.canRedo());
+    if (ImGui::Button("Redo")) m_editor->redo();
+    ImGui::EndDisabled();
+    ImGui::SameLine();
+    int position = (int)history.getPosition();
+    if (ImGui::SliderInt("History", &position, 0, (int)history.getCount())) {
+        m_editor->jumpToHistory((size_t)position);
+    }
+
     // Brush size
     int brushSize = m_editor->getBrushSize();
     if (ImGui::SliderInt("Brush Size", &brushSize, 1, 10)) {
         m_editor->setBrushSize(brushSize);
     }
 
+    // Fade the whole crosshair
+    ImGui::SliderInt("Opacity", &m_opacityPercent, 0, 100, "%d%%");
+    ImGui::SameLine();
+    if (ImGui::Button("Apply Opacity")) {
+        m_crosshair->multiplyAlpha((uint8_t)(m_opacityPercent * 255 / 100));
+    }
+
     // Preview the crosshair
     if (ImGui::Button("Preview")) {
         m_editor->previewResult();
     }
 
+    ImGui::TextDisabled("History: %zu of %zu edits, %.1f KB",
+        history.getPosition(), history.getCount(), history.getMemoryUsage() / 1024.0);
+
+    // Footprint of the current crosshair
+    PixelRect bounds = m_crosshair->getOpaqueBounds();
+    if (bounds.isEmpty()) {
+        ImGui::Text("Footprint: empty");
+    }
+    else {
+        int gridSize = m_crosshair->getSize();
+        int opaqueCount = m_crosshair->getOpaqueCount();
+        ImGui::Text("Footprint: %dx%d at (%d, %d), %d opaque px (%.1f%% of grid, %.1f%% of bounds)",
+            bounds.width(), bounds.height(), bounds.minX, bounds.minY, opaqueCount,
+            100.0f * opaqueCount / (gridSize * gridSize),
+            100.0f * opaqueCount / (bounds.width() * bounds.height()));
+    }
+
+    const char* formatNames[] = { "1-bit mask", "8-bit palette", "RGBA", "16x16 tiles" };
+    ImGui::Text("Storage: %s, %zu bytes",
+        formatNames[(int)m_crosshair->getStorageFormat()], m_crosshair->getStorageBytes());
+
     ImGui::EndGroup();
     ImGui::Separator();
 }
@@ -243,27 +607,97 @@ void EditorWindow::renderPresetManager() {
     }
 
     ImGui::Text("Available Presets:");
-    ImGui::BeginChild("PresetList", ImVec2(0, 150), true);
+    ImGui::InputText("Search", m_searchText, sizeof(m_searchText));
+
+    // Searched again only when the query or the list changes
+    if (!m_filterValid || m_filteredVersion != m_presetIndex.getVersion() || m_filteredQuery != m_searchText) {
+        m_filteredQuery = m_searchText;
+        m_filteredPresets = m_presetIndex.search(m_filteredQuery);
+        m_filteredVersion = m_presetIndex.getVersion();
+        m_filterValid = true;
+    }
 
-    for (const auto& preset : m_presets) {
-        bool isSelected = (preset == m_currentPreset);
-        if (ImGui::Selectable(preset.c_str(), isSelected)) {
-            loadPreset(preset);
-        }
+    ImGui::BeginChild("PresetList", ImVec2(0, 150), true);
 
-        if (ImGui::BeginPopupContextItem()) {
-            if (ImGui::MenuItem("Load")) {
+    const float rowHeight = (float)ThumbnailAtlas::THUMBNAIL_SIZE;
+    ImDrawList* drawList = ImGui::GetWindowDrawList();
+
+    // Thumbnails go to their own channel, so they end up next to each other
+    // and draw as one command between a single sampler switch and reset
+    drawList->ChannelsSplit(2);
+    drawList->ChannelsSetCurrent(1);
+    bool drawThumbnails = m_thumbnails.beginDraw(drawList);
+    drawList->ChannelsSetCurrent(0);
+
+    // Only the rows in view are submitted
+    ImGuiListClipper clipper;
+    clipper.Begin((int)m_filteredPresets.size(), rowHeight + ImGui::GetStyle().ItemSpacing.y);
+    while (clipper.Step()) {
+        for (int row = clipper.DisplayStart; row < clipper.DisplayEnd; row++) {
+            const std::string& preset = m_presetIndex.at(m_filteredPresets[row]);
+            bool isSelected = (preset == m_currentPreset);
+
+            // Thumbnail and name are drawn over an unlabeled selectable row
+            ImGui::PushID(preset.c_str());
+            if (ImGui::Selectable("##preset", isSelected, 0, ImVec2(0, rowHeight))) {
                 loadPreset(preset);
             }
-            if (ImGui::MenuItem("Delete")) {
-                deletePreset(preset);
+
+            if (ImGui::IsItemVisible()) {
+                ImVec2 rowMin = ImGui::GetItemRectMin();
+                if (drawThumbnails) {
+                    drawList->ChannelsSetCurrent(1);
+                    drawPresetThumbnail(preset, drawList, rowMin.x, rowMin.y);
+                    drawList->ChannelsSetCurrent(0);
+                }
+                drawList->AddText(ImVec2(rowMin.x + rowHeight + ImGui::GetStyle().ItemSpacing.x,
+                    rowMin.y + (rowHeight - ImGui::GetFontSize()) * 0.5f), ImGui::GetColorU32(ImGuiCol_Text), preset.c_str());
+            }
+
+            if (ImGui::BeginPopupContextItem()) {
+                if (ImGui::MenuItem("Load")) {
+                    loadPreset(preset);
+                }
+                if (ImGui::MenuItem("Delete")) {
+                    deletePreset(preset);
+                }
+                ImGui::EndPopup();
             }
-            ImGui::EndPopup();
+            ImGui::PopID();
         }
     }
 
+    drawList->ChannelsSetCurrent(1);
+    m_thumbnails.endDraw(drawList);
+    drawList->ChannelsMerge();
+
     ImGui::EndChild();
 
+    if (ImGui::Button("Find Duplicates") && m_fileManager) {
+        FileManager* fileManager = m_fileManager.get();
+        m_ioWorker->submit("duplicates", [fileManager]() {
+            return fileManager->findDuplicatePresets();
+        }, [this](std::vector<std::vector<std::string>> duplicates) {
+            m_duplicatePresets = std::move(duplicates);
+            m_showDuplicates = true;
+        });
+    }
+
+    if (m_showDuplicates) {
+        if (m_duplicatePresets.empty()) {
+            ImGui::Text("No duplicate presets");
+        }
+
+        // One line per group of identical presets
+        for (const auto& group : m_duplicatePresets) {
+            std::string line;
+            for (const auto& name : group) {
+                line += line.empty() ? name : " = " + name;
+            }
+            ImGui::BulletText("%s", line.c_str());
+        }
+    }
+
     ImGui::EndGroup();
     ImGui::Separator();
 }
@@ -277,6 +711,7 @@ void EditorWindow::renderSettings() {
 
     ImGui::Checkbox("Start with Windows", &settings.startWithWindows);
     ImGui::Checkbox("Start Minimized", &settings.startMinimized);
+    ImGui::Checkbox("Store Presets in One Library File", &settings.usePresetLibrary);
 
     // Crosshair scale slider
     float scale = settings.crosshairScale;
@@ -284,65 +719,294 @@ void EditorWindow::renderSettings() {
         settings.crosshairScale = scale;
     }
 
+    // Memory for decoded presets, which switch without reading the disk
+    ImGui::SliderInt("Preset Cache (MB)", &settings.presetCacheMB, 1, 1024);
+    ImGui::TextDisabled("Preset cache: %.1f MB used, %d presets decoded at startup",
+        m_fileManager->getPresetCacheBytes() / (1024.0 * 1024.0), m_warmedPresets);
+    ImGui::TextDisabled("Prepared for swapping: %zu presets, %.1f MB",
+        m_preparedPresets.getCount(), m_preparedPresets.getBytes() / (1024.0 * 1024.0));
+    if (m_lastSwitchMicros >= 0) {
+        ImGui::TextDisabled("Last preset switch: %lld us (%s)",
+            (long long)m_lastSwitchMicros, m_lastSwitchSource);
+    }
+
+    // Memory for undo history; the oldest edits are dropped past it
+    ImGui::SliderInt("Undo History (MB)", &settings.undoHistoryMB, 1, 256);
+
     if (ImGui::Button("Apply Settings")) {
         applySettings();
     }
     ImGui::SameLine();
     if (ImGui::Button("Save Settings")) {
-        settings.save();
+        settings.saveAsync(*m_ioWorker);
     }
 
+    const Settings::SaveStats& stats = settings.getSaveStats();
+    ImGui::TextDisabled("Settings written %llu times, %llu writes avoided, %llu failed",
+        (unsigned long long)stats.writes, (unsigned long long)(stats.requests - stats.writes),
+        (unsigned long long)stats.failed);
+
     ImGui::EndGroup();
 }
 
 void EditorWindow::savePreset(const std::string& name) {
     if (!m_crosshair || !m_fileManager) return;
 
-    if (m_fileManager->savePreset(name, *m_crosshair)) {
+    // Write a snapshot, so editing can go on while it is saved
+    auto snapshot = std::make_shared<Crosshair>();
+    snapshot->assignPixels(m_crosshair->getSize(), m_crosshair->getPixels());
+    uint64_t hash = snapshot->getContentHash();
+
+    FileManager* fileManager = m_fileManager.get();
+    m_ioWorker->submit("preset:" + name, [fileManager, name, snapshot]() {
+        return fileManager->savePreset(name, *snapshot);
+    }, [this, name, hash](bool saved) {
+        if (!saved) return;
+
+        // The watcher reports this write too; it is not an outside edit
+        m_currentPresetHash = hash;
+
         m_currentPreset = name;
-        refreshPresetList();
+        m_presetIndex.insert(name);
+
+        // Edits made while the save ran are still unsaved
+        if (m_crosshair->getContentHash() == hash) {
+            resetJournal();
+        } else {
+            checkpointJournal();
+        }
+
+        // The duplicate report is stale once the presets change
+        m_showDuplicates = false;
+
+        // The preset's content changed, so it needs a new thumbnail
+        m_thumbnailRequests.erase(name);
 
         // Update last loaded preset in settings
         Settings::getInstance().lastLoadedPreset = name;
-        Settings::getInstance().save();
+        Settings::getInstance().requestSave();
 
         // Call the save callback if set
         if (m_saveCallback) {
             m_saveCallback();
         }
-    }
+    });
 }
 
 void EditorWindow::loadPreset(const std::string& name) {
     if (!m_crosshair || !m_fileManager) return;
 
-    if (m_fileManager->loadPreset(name, *m_crosshair)) {
-        m_currentPreset = name;
+    // A load still running on the worker must not override this one
+    uint64_t sequence = ++m_loadSequence;
+    auto start = std::chrono::steady_clock::now();
 
-        // Update last loaded preset in settings
-        Settings::getInstance().lastLoadedPreset = name;
-        Settings::getInstance().save();
+    // Prepared presets switch by swapping grids. Presets only in the pixel
+    // cache (the prepared budget ran out, or they were not built yet) are
+    // still copied in; both skip the trip through the worker.
+    if (swapInPreparedPreset(name, start)) {
+        return;
+    }
+
+    std::shared_ptr<const PixelCache::Pixels> cached = m_fileManager->findCachedPreset(name);
+    if (cached) {
+        applyLoadedPreset(name, *cached, start, true);
+        return;
+    }
+
+    // Only the most recently requested preset is worth loading
+    FileManager* fileManager = m_fileManager.get();
+    m_ioWorker->submit("load", [fileManager, name]() {
+        return fileManager->readPreset(name);
+    }, [this, name, sequence, start](std::shared_ptr<const PixelCache::Pixels> pixels) {
+        if (!pixels || sequence != m_loadSequence) return;
+
+        applyLoadedPreset(name, *pixels, start, false);
+    });
+}
+
+void EditorWindow::applyLoadedPreset(const std::string& name, const PixelCache::Pixels& pixels,
+    std::chrono::steady_clock::time_point start, bool cached) {
+    m_crosshair->assignPixels(pixels.size, pixels.data);
+    finishPresetSwitch(name, start, cached ? "cached" : "from disk");
+}
+
+bool EditorWindow::swapInPreparedPreset(const std::string& name, std::chrono::steady_clock::time_point start) {
+    uint64_t hash;
+    if (!m_fileManager->findCachedPresetHash(name, hash)) return false;
+
+    std::shared_ptr<Crosshair> prepared = m_preparedPresets.take(hash);
+    if (!prepared) return false;
+
+    // The grid swapped out still holds the preset switched away from, unless
+    // it was edited, so it stays prepared for switching back
+    bool unedited = m_crosshair->getGeneration() == m_switchGeneration;
+    uint64_t previousHash = m_currentPresetHash;
+    m_crosshair->swapPixels(*prepared);
+    if (unedited) {
+        m_preparedPresets.keep(previousHash, std::move(prepared));
+    }
+
+    finishPresetSwitch(name, start, "swapped");
+    return true;
+}
+
+void EditorWindow::finishPresetSwitch(const std::string& name, std::chrono::steady_clock::time_point start,
+    const char* source) {
+    m_currentPreset = name;
+    if (!m_fileManager->findCachedPresetHash(name, m_currentPresetHash)) {
+        m_currentPresetHash = m_crosshair->getContentHash();
     }
+    m_switchGeneration = m_crosshair->getGeneration();
+    m_editor->resetHistory();
+    resetJournal();
+
+    m_lastSwitchMicros = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - start).count();
+    m_lastSwitchSource = source;
+
+    // Update last loaded preset in settings
+    Settings::getInstance().lastLoadedPreset = name;
+    Settings::getInstance().requestSave();
+
+    prepareNeighborPresets();
+}
+
+void EditorWindow::cyclePreset(int step) {
+    if (m_presetIndex.empty()) return;
+
+    size_t count = m_presetIndex.size();
+    size_t position;
+    if (!m_presetIndex.find(m_currentPreset, position)) {
+        position = step > 0 ? count - 1 : 0;
+    }
+
+    size_t offset = (size_t)((step % (int)count + (int)count) % (int)count);
+    loadPreset(m_presetIndex.at((position + offset) % count));
+}
+
+void EditorWindow::prepareNeighborPresets() {
+    if (!m_warmWorker || m_presetIndex.size() < 2) return;
+
+    size_t position;
+    if (!m_presetIndex.find(m_currentPreset, position)) return;
+
+    // Skip neighbors already prepared
+    size_t count = m_presetIndex.size();
+    std::vector<std::string> names;
+    for (size_t neighbor : { (position + 1) % count, (position + count - 1) % count }) {
+        const std::string& name = m_presetIndex.at(neighbor);
+        uint64_t hash;
+        if (m_fileManager->findCachedPresetHash(name, hash) && m_preparedPresets.contains(hash)) continue;
+        if (std::find(names.begin(), names.end(), name) == names.end()) {
+            names.push_back(name);
+        }
+    }
+    if (names.empty()) return;
+
+    // Decoding and building the grids is the part of a switch worth doing ahead
+    FileManager* fileManager = m_fileManager.get();
+    size_t budget = m_preparedPresets.getBudget();
+    m_warmWorker->submit("prepare", [fileManager, names, budget]() {
+        return preparePresets(fileManager, names, budget, false);
+    }, [this](PreparedList prepared) {
+        for (auto& [hash, crosshair] : prepared) {
+            m_preparedPresets.keep(hash, std::move(crosshair));
+        }
+    });
+}
+
+void EditorWindow::drawPresetThumbnail(const std::string& name, ImDrawList* drawList, float x, float y) {
+    if (!m_fileManager) return;
+
+    const float size = (float)ThumbnailAtlas::THUMBNAIL_SIZE;
+    uint64_t hash;
+    const ThumbnailAtlas::Region* region = nullptr;
+    if (m_fileManager->findCachedPresetHash(name, hash)) {
+        region = m_thumbnails.find(hash);
+    }
+
+    if (region) {
+        m_thumbnails.draw(drawList, *region, x, y, x + size, y + size);
+        return;
+    }
+
+    // Each preset is asked for once; its content hash decides whether the
+    // worker renders a thumbnail or reads the one it stored before
+    if (!m_thumbnailRequests.insert(name).second) return;
+
+    FileManager* fileManager = m_fileManager.get();
+    m_thumbnailWorker->submit("thumbnail:" + name, [fileManager, name]() {
+        return fileManager->readThumbnail(name);
+    }, [this](std::shared_ptr<const PresetThumbnail> thumbnail) {
+        if (!thumbnail) return;
+
+        m_thumbnails.add(thumbnail->hash, thumbnail->size, thumbnail->pixels.data());
+
+        // Clearing the atlas to make room dropped the other thumbnails
+        if (m_thumbnails.getGeneration() != m_thumbnailGeneration) {
+            m_thumbnailGeneration = m_thumbnails.getGeneration();
+            m_thumbnailRequests.clear();
+        }
+    });
+}
+
+void EditorWindow::warmPresetCache() {
+    if (!m_fileManager) return;
+
+    // Whatever fits the prepared budget is also built into crosshairs, so
+    // switching to it is a swap rather than a copy
+    FileManager* fileManager = m_fileManager.get();
+    size_t budget = m_preparedPresets.getBudget();
+    m_warmWorker->submit("warm", [fileManager, budget]() {
+        int decoded = fileManager->warmPresetCache();
+        return std::make_pair(decoded, preparePresets(fileManager, fileManager->getPresetNames(), budget, true));
+    }, [this](std::pair<int, PreparedList> result) {
+        m_warmedPresets = result.first;
+
+        // In reverse, so the first presets in the list end up most recently used
+        for (auto it = result.second.rbegin(); it != result.second.rend(); ++it) {
+            m_preparedPresets.keep(it->first, std::move(it->second));
+        }
+    });
 }
 
 void EditorWindow::deletePreset(const std::string& name) {
     if (!m_fileManager) return;
 
-    if (m_fileManager->deletePreset(name)) {
-        refreshPresetList();
+    // Shares the key of saves to the same preset, so a queued save is dropped
+    FileManager* fileManager = m_fileManager.get();
+    m_ioWorker->submit("preset:" + name, [fileManager, name]() {
+        return fileManager->deletePreset(name);
+    }, [this, name](bool deleted) {
+        if (!deleted) return;
+
+        m_presetIndex.remove(name);
+        m_thumbnailRequests.erase(name);
+        m_showDuplicates = false;
 
         // If we deleted the current preset, load the first available one
-        if (name == m_currentPreset && !m_presets.empty()) {
-            loadPreset(m_presets[0]);
+        if (name == m_currentPreset && !m_presetIndex.empty()) {
+            loadPreset(m_presetIndex.at(0));
         }
-    }
+    });
 }
 
-void EditorWindow::refreshPresetList() {
+void EditorWindow::refreshPresetList(std::function<void()> then) {
     if (!m_fileManager) return;
 
-    m_presets = m_fileManager->getPresetNames();
-    std::sort(m_presets.begin(), m_presets.end());
+    FileManager* fileManager = m_fileManager.get();
+    m_ioWorker->submit("list", [fileManager]() {
+        return fileManager->getPresetNames();
+    }, [this, then](std::vector<std::string> presets) {
+        m_presetIndex.assign(std::move(presets));
+
+        // The duplicate report is stale once the presets change
+        m_showDuplicates = false;
+
+        if (then) {
+            then();
+        }
+    });
 }
 
 void EditorWindow::applySettings() {
@@ -366,6 +1030,36 @@ void EditorWindow::applySettings() {
         RegCloseKey(hKey);
     }
 
+    // Switch preset storage; a new library imports the directory first
+    if (m_fileManager && settings.usePresetLibrary != m_libraryEnabled) {
+        FileManager* fileManager = m_fileManager.get();
+        bool enable = settings.usePresetLibrary;
+        m_libraryEnabled = enable;
+
+        m_ioWorker->submit("library", [fileManager, enable]() {
+            return fileManager->setLibraryEnabled(enable);
+        }, [this](bool switched) {
+            if (!switched) {
+                m_libraryEnabled = false;
+                Settings::getInstance().usePresetLibrary = false;
+                Settings::getInstance().requestSave();
+            }
+            refreshPresetList();
+            warmPresetCache();
+
+            // Names may hold different content in the other store
+            m_thumbnailRequests.clear();
+        });
+    }
+
+    if (m_fileManager) {
+        m_fileManager->setPresetCacheBudget((size_t)settings.presetCacheMB * 1024 * 1024);
+    }
+
+    if (m_editor) {
+        m_editor->setHistoryBudget((size_t)settings.undoHistoryMB * 1024 * 1024);
+    }
+
     // Save settings to file
-    settings.save();
+    settings.requestSave();
 }
\ No newline at end of file
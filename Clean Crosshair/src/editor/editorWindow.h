@@ -3,12 +3,19 @@
 #include <memory>
 #include <string>
 #include <vector>
+#include <unordered_set>
 #include <functional>
+#include <chrono>
 #include <windows.h>
 #include "../common/crosshair.h"
 #include "../common/fileManager.h"
+#include "../common/ioWorker.h"
+#include "../common/directoryWatcher.h"
+#include "../common/editJournal.h"
 #include "crosshairEditor.h"
 #include "settings.h"
+#include "presetIndex.h"
+#include "preparedPresets.h"
 
 class EditorWindow {
 public:
@@ -30,6 +37,16 @@ public:
     // Set crosshair reference
     void setCrosshair(std::shared_ptr<Crosshair> crosshair);
 
+    // Switch to the next (step 1) or previous (step -1) preset in list order,
+    // wrapping around
+    void cyclePreset(int step);
+
+    // Apply the results of finished background I/O; call once per frame
+    void update();
+
+    // Finish background I/O and write unsaved settings; call before exit
+    void shutdown();
+
     // Render editor window
     void render();
 
@@ -42,6 +59,14 @@ public:
     // Set callback for when crosshair is saved
     void setSaveCallback(std::function<void()> callback) { m_saveCallback = callback; }
 
+    // Texture the preset thumbnails are drawn from; release it with null
+    // before the renderer goes away
+    void setThumbnailTexture(std::shared_ptr<PixelTexture> texture);
+
+    // Texture the editor grid is drawn from; release it with null before
+    // the renderer goes away
+    void setCanvasTexture(std::shared_ptr<PixelTexture> texture);
+
 private:
     // UI rendering functions
     void renderToolbar();
@@ -49,11 +74,56 @@ private:
     void renderPresetManager();
     void renderSettings();
 
-    // Save/load crosshair presets
+    // Save/load crosshair presets. These run on the I/O worker and update
+    // the window when they complete; presets already in the cache load at once.
     void savePreset(const std::string& name);
     void loadPreset(const std::string& name);
     void deletePreset(const std::string& name);
-    void refreshPresetList();
+    void refreshPresetList(std::function<void()> then = nullptr);
+
+    // Show loaded pixels and record how long the switch took
+    void applyLoadedPreset(const std::string& name, const PixelCache::Pixels& pixels,
+        std::chrono::steady_clock::time_point start, bool cached);
+
+    // Switch to a prepared preset by swapping grids; false if it is not prepared
+    // (not built yet, or dropped to stay within the prepared budget)
+    bool swapInPreparedPreset(const std::string& name, std::chrono::steady_clock::time_point start);
+
+    // Bookkeeping shared by every way of switching presets
+    void finishPresetSwitch(const std::string& name, std::chrono::steady_clock::time_point start,
+        const char* source);
+
+    // Build the presets next to the current one in list order on the warm-up
+    // worker, so cycling to them is a swap
+    void prepareNeighborPresets();
+
+    // Decode all presets into the cache in the background, and build as many
+    // as fit the prepared budget into crosshairs
+    void warmPresetCache();
+
+    // Apply preset and settings files changed outside the editor
+    void applyFileChanges();
+
+    // Load the current preset again if its file no longer holds what was
+    // last loaded or saved
+    void reloadCurrentPreset();
+
+    // Draw a preset's thumbnail, asking the worker for it if it is not in the
+    // atlas yet
+    void drawPresetThumbnail(const std::string& name, ImDrawList* drawList, float x, float y);
+
+    // Log edits made since the last frame to the journal
+    void journalEdits();
+
+    // Start the journal over on top of the current preset as loaded or saved
+    void resetJournal();
+
+    // Start the journal over from the whole grid as it is now
+    void checkpointJournal();
+
+    // Replay the journal left by the last session; false if there was
+    // nothing to recover
+    bool recoverJournal();
 
     // Apply settings
     void applySettings();
@@ -68,9 +138,74 @@ private:
     std::unique_ptr<CrosshairEditor> m_editor;
     std::unique_ptr<FileManager> m_fileManager;
 
-    std::vector<std::string> m_presets;
+    // Declared after the file manager so it is destroyed, and drained, first
+    std::unique_ptr<IoWorker> m_ioWorker;
+
+    // Runs the cache warm-up, which would otherwise hold up every load and
+    // save queued on m_ioWorker until the whole library is decoded
+    std::unique_ptr<IoWorker> m_warmWorker;
+
+    // Reads and renders thumbnails, so scrolling a long list never queues
+    // work in front of a load or save
+    std::unique_ptr<IoWorker> m_thumbnailWorker;
+
+    // Unsaved edits on top of the current preset; appends go through their
+    // own worker so they never wait behind preset I/O
+    EditJournal m_journal;
+    std::unique_ptr<IoWorker> m_journalWorker;
+    std::string m_journalPath;
+    uint64_t m_journalGeneration;
+    size_t m_journalBytes;
+    bool m_journalReady;
+
+    // Every preset name, and the sorted positions of those matching the
+    // search box as of m_filteredVersion
+    PresetIndex m_presetIndex;
+    char m_searchText[64];
+    std::string m_filteredQuery;
+    std::vector<uint32_t> m_filteredPresets;
+    uint64_t m_filteredVersion;
+    bool m_filterValid;
+
+    // Content hash of the current preset as last loaded or saved
+    uint64_t m_currentPresetHash;
+
+    // Changes to the preset directory and to the settings file's directory
+    DirectoryWatcher m_presetWatcher;
+    DirectoryWatcher m_settingsWatcher;
     std::string m_currentPreset;
     std::string m_newPresetName;
+    int m_opacityPercent;
+
+    // Last duplicate report (see FileManager::findDuplicatePresets)
+    std::vector<std::vector<std::string>> m_duplicatePresets;
+    bool m_showDuplicates;
+
+    // Preset storage as last requested from the worker
+    bool m_libraryEnabled;
+
+    // Bumped by every loadPreset(); older loads finishing late are dropped
+    uint64_t m_loadSequence;
+
+    // Time from the last loadPreset() to the new pixels being in place, or -1
+    long long m_lastSwitchMicros;
+    const char* m_lastSwitchSource;
+
+    // Crosshair generation right after the last switch; the grid has not been
+    // edited since while it matches
+    uint64_t m_switchGeneration;
+
+    // Presets built into whole crosshairs off the UI thread
+    PreparedPresets m_preparedPresets;
+
+    // Presets decoded by the last cache warm-up
+    int m_warmedPresets;
+
+    // Thumbnails of the preset list, and the presets whose thumbnails were
+    // asked for since the atlas was last cleared
+    ThumbnailAtlas m_thumbnails;
+    std::unordered_set<std::string> m_thumbnailRequests;
+    unsigned m_thumbnailGeneration;
 
     std::function<void()> m_closeCallback;
     std::function<void()> m_saveCallback;
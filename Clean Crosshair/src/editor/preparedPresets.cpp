@@ -0,0 +1,56 @@
+#include "preparedPresets.h"
+#include "../common/crosshair.h"
+
+PreparedPresets::PreparedPresets(size_t budget)
+    : m_budget(budget),
+    m_bytes(0) {
+}
+
+std::shared_ptr<Crosshair> PreparedPresets::take(uint64_t hash) {
+    auto it = m_lookup.find(hash);
+    if (it == m_lookup.end()) {
+        return nullptr;
+    }
+
+    std::shared_ptr<Crosshair> crosshair = std::move(it->second->crosshair);
+    m_bytes -= it->second->bytes;
+    m_entries.erase(it->second);
+    m_lookup.erase(it);
+    return crosshair;
+}
+
+void PreparedPresets::keep(uint64_t hash, std::shared_ptr<Crosshair> crosshair) {
+    auto it = m_lookup.find(hash);
+    if (it != m_lookup.end()) {
+        m_entries.splice(m_entries.begin(), m_entries, it->second);
+        return;
+    }
+
+    size_t bytes = crosshair->getStorageBytes() + sizeof(Crosshair);
+    m_entries.push_front({ hash, std::move(crosshair), bytes });
+    m_lookup[hash] = m_entries.begin();
+    m_bytes += bytes;
+
+    trim();
+}
+
+void PreparedPresets::trim() {
+    // The newest grid is kept even if it alone exceeds the budget
+    while (m_bytes > m_budget && m_entries.size() > 1) {
+        const Entry& oldest = m_entries.back();
+        m_bytes -= oldest.bytes;
+        m_lookup.erase(oldest.hash);
+        m_entries.pop_back();
+    }
+}
+
+void PreparedPresets::clear() {
+    m_entries.clear();
+    m_lookup.clear();
+    m_bytes = 0;
+}
+
+void PreparedPresets::setBudget(size_t budget) {
+    m_budget = budget;
+    trim();
+}
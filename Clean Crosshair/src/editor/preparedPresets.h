@@ -0,0 +1,59 @@
+#pragma once
+
+#include <list>
+#include <unordered_map>
+#include <memory>
+#include <cstdint>
+#include <cstddef>
+
+class Crosshair;
+
+// Presets built into whole crosshairs ahead of time, keyed by content hash,
+// so switching to one is a Crosshair::swapPixels instead of a copy. A switch
+// takes the grid out, and the grid switched away from can go back in, so the
+// set keeps holding what there is to switch to. The least recently used grids
+// are dropped once their storage is over the byte budget; grids are stored
+// in their compact format, so the budget holds far more presets than the
+// decoded pixel cache.
+class PreparedPresets {
+public:
+    static constexpr size_t DEFAULT_BUDGET = 32 * 1024 * 1024;
+
+    explicit PreparedPresets(size_t budget = DEFAULT_BUDGET);
+
+    bool contains(uint64_t hash) const { return m_lookup.count(hash) != 0; }
+
+    // Remove the grid kept for a content hash and hand it over, or null
+    std::shared_ptr<Crosshair> take(uint64_t hash);
+
+    // Keep a grid as the most recently used. If the hash is already kept,
+    // that grid is marked used instead and this one is dropped. The grid must
+    // not change while it is kept.
+    void keep(uint64_t hash, std::shared_ptr<Crosshair> crosshair);
+
+    void clear();
+
+    // Change the byte budget, dropping grids until the set fits
+    void setBudget(size_t budget);
+    size_t getBudget() const { return m_budget; }
+
+    size_t getCount() const { return m_entries.size(); }
+    size_t getBytes() const { return m_bytes; }
+
+private:
+    struct Entry {
+        uint64_t hash;
+        std::shared_ptr<Crosshair> crosshair;
+        size_t bytes;
+    };
+
+    size_t m_budget;
+    size_t m_bytes;
+
+    // Most recently used first
+    std::list<Entry> m_entries;
+    std::unordered_map<uint64_t, std::list<Entry>::iterator> m_lookup;
+
+    // Drop the oldest grids while over budget
+    void trim();
+};
@@ -0,0 +1,200 @@
+#include "presetIndex.h"
+#include <algorithm>
+#include <cctype>
+
+static std::string toKey(std::string_view name) {
+    std::string key(name);
+    for (char& c : key) {
+        c = (char)std::tolower((unsigned char)c);
+    }
+    return key;
+}
+
+static uint32_t packTrigram(const char* text) {
+    return (uint32_t)(uint8_t)text[0] | ((uint32_t)(uint8_t)text[1] << 8) | ((uint32_t)(uint8_t)text[2] << 16);
+}
+
+PresetIndex::PresetIndex()
+    : m_version(0) {
+}
+
+template <typename Fn>
+void PresetIndex::forEachTrigram(std::string_view key, Fn&& fn) {
+    std::vector<uint32_t> seen;
+    for (size_t i = 0; i + 3 <= key.size(); i++) {
+        uint32_t trigram = packTrigram(key.data() + i);
+        if (std::find(seen.begin(), seen.end(), trigram) == seen.end()) {
+            seen.push_back(trigram);
+            fn(trigram);
+        }
+    }
+}
+
+void PresetIndex::assign(std::vector<std::string> names) {
+    m_entries.clear();
+    m_freeIds.clear();
+    m_sorted.clear();
+    m_trigrams.clear();
+
+    // One sort for the whole list, then duplicates are dropped
+    std::vector<Entry> entries;
+    entries.reserve(names.size());
+    for (std::string& name : names) {
+        std::string key = toKey(name);
+        entries.push_back({ std::move(name), std::move(key), true });
+    }
+    std::sort(entries.begin(), entries.end(), [](const Entry& a, const Entry& b) {
+        return a.key != b.key ? a.key < b.key : a.name < b.name;
+    });
+    entries.erase(std::unique(entries.begin(), entries.end(), [](const Entry& a, const Entry& b) {
+        return a.name == b.name;
+    }), entries.end());
+
+    m_entries = std::move(entries);
+    m_sorted.resize(m_entries.size());
+    for (uint32_t id = 0; id < (uint32_t)m_entries.size(); id++) {
+        m_sorted[id] = id;
+        forEachTrigram(m_entries[id].key, [&](uint32_t trigram) {
+            m_trigrams[trigram].push_back(id);
+        });
+    }
+
+    m_version++;
+}
+
+size_t PresetIndex::lowerBound(std::string_view key) const {
+    auto it = std::lower_bound(m_sorted.begin(), m_sorted.end(), key, [&](uint32_t id, std::string_view value) {
+        return m_entries[id].key < value;
+    });
+    return it - m_sorted.begin();
+}
+
+bool PresetIndex::contains(const std::string& name) const {
+    size_t position;
+    return find(name, position);
+}
+
+bool PresetIndex::find(const std::string& name, size_t& position) const {
+    std::string key = toKey(name);
+    for (size_t i = lowerBound(key); i < m_sorted.size() && m_entries[m_sorted[i]].key == key; i++) {
+        if (m_entries[m_sorted[i]].name == name) {
+            position = i;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool PresetIndex::insert(const std::string& name) {
+    if (contains(name)) return false;
+
+    uint32_t id;
+    if (!m_freeIds.empty()) {
+        id = m_freeIds.back();
+        m_freeIds.pop_back();
+        m_entries[id] = { name, toKey(name), true };
+    }
+    else {
+        id = (uint32_t)m_entries.size();
+        m_entries.push_back({ name, toKey(name), true });
+    }
+
+    const Entry& entry = m_entries[id];
+    size_t position = lowerBound(entry.key);
+    while (position < m_sorted.size() && m_entries[m_sorted[position]].key == entry.key
+        && m_entries[m_sorted[position]].name < entry.name) {
+        position++;
+    }
+    m_sorted.insert(m_sorted.begin() + position, id);
+
+    forEachTrigram(entry.key, [&](uint32_t trigram) {
+        m_trigrams[trigram].push_back(id);
+    });
+
+    m_version++;
+    return true;
+}
+
+bool PresetIndex::remove(const std::string& name) {
+    std::string key = toKey(name);
+    size_t position = lowerBound(key);
+    while (position < m_sorted.size() && m_entries[m_sorted[position]].key == key
+        && m_entries[m_sorted[position]].name != name) {
+        position++;
+    }
+    if (position == m_sorted.size() || m_entries[m_sorted[position]].name != name) {
+        return false;
+    }
+
+    uint32_t id = m_sorted[position];
+    m_sorted.erase(m_sorted.begin() + position);
+
+    forEachTrigram(key, [&](uint32_t trigram) {
+        auto it = m_trigrams.find(trigram);
+        std::vector<uint32_t>& ids = it->second;
+        ids.erase(std::find(ids.begin(), ids.end(), id));
+        if (ids.empty()) {
+            m_trigrams.erase(it);
+        }
+    });
+
+    m_entries[id] = { std::string(), std::string(), false };
+    m_freeIds.push_back(id);
+
+    m_version++;
+    return true;
+}
+
+std::vector<uint32_t> PresetIndex::search(std::string_view query) const {
+    std::vector<uint32_t> positions;
+    std::string key = toKey(query);
+
+    if (key.empty()) {
+        positions.resize(m_sorted.size());
+        for (uint32_t i = 0; i < (uint32_t)positions.size(); i++) {
+            positions[i] = i;
+        }
+        return positions;
+    }
+
+    // Too short for a trigram: the sorted keys give every prefix match in a row
+    if (key.size() < 3) {
+        for (size_t i = lowerBound(key); i < m_sorted.size(); i++) {
+            if (m_entries[m_sorted[i]].key.compare(0, key.size(), key) != 0) break;
+            positions.push_back((uint32_t)i);
+        }
+        return positions;
+    }
+
+    // Candidates come from the query's rarest trigram and are then checked
+    // for the whole query
+    const std::vector<uint32_t>* rarest = nullptr;
+    bool missing = false;
+    forEachTrigram(key, [&](uint32_t trigram) {
+        auto it = m_trigrams.find(trigram);
+        if (it == m_trigrams.end()) {
+            missing = true;
+        }
+        else if (!rarest || it->second.size() < rarest->size()) {
+            rarest = &it->second;
+        }
+    });
+    if (missing || !rarest) {
+        return positions;
+    }
+
+    for (uint32_t id : *rarest) {
+        const Entry& entry = m_entries[id];
+        if (entry.key.find(key) == std::string::npos) continue;
+
+        // Position of this exact entry among equal keys
+        size_t position = lowerBound(entry.key);
+        while (m_sorted[position] != id) {
+            position++;
+        }
+        positions.push_back((uint32_t)position);
+    }
+
+    std::sort(positions.begin(), positions.end());
+    return positions;
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <unordered_map>
+#include <cstdint>
+
+// Preset names kept sorted (case-insensitively) for the preset browser, with
+// a trigram index for searching. Adding or removing a name updates both in
+// place instead of rebuilding them.
+class PresetIndex {
+public:
+    PresetIndex();
+
+    // Replace every name
+    void assign(std::vector<std::string> names);
+
+    // Add a name at its sorted position; false if it is already present
+    bool insert(const std::string& name);
+
+    // Remove a name; false if it was not present
+    bool remove(const std::string& name);
+
+    bool contains(const std::string& name) const;
+
+    // Sorted position of a name; false if it is not present
+    bool find(const std::string& name, size_t& position) const;
+
+    size_t size() const { return m_sorted.size(); }
+    bool empty() const { return m_sorted.empty(); }
+
+    // i-th name in sorted order
+    const std::string& at(size_t i) const { return m_entries[m_sorted[i]].name; }
+
+    // Sorted positions of the names containing query, ignoring case. Queries
+    // shorter than a trigram match name prefixes instead.
+    std::vector<uint32_t> search(std::string_view query) const;
+
+    // Bumped by every change, so callers can tell when search results are stale
+    uint64_t getVersion() const { return m_version; }
+
+private:
+    struct Entry {
+        std::string name;
+        std::string key;  // Lowercase name, used for ordering and matching
+        bool live;
+    };
+
+    // Entries by id; ids of removed names are reused
+    std::vector<Entry> m_entries;
+    std::vector<uint32_t> m_freeIds;
+
+    // Ids in name order
+    std::vector<uint32_t> m_sorted;
+
+    // Ids of the names containing each trigram
+    std::unordered_map<uint32_t, std::vector<uint32_t>> m_trigrams;
+
+    uint64_t m_version;
+
+    // First sorted position whose key is not less than key
+    size_t lowerBound(std::string_view key) const;
+
+    // Call fn for every distinct trigram of key
+    template <typename Fn>
+    static void forEachTrigram(std::string_view key, Fn&& fn);
+};
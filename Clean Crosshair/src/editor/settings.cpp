@@ -1,20 +1,179 @@
 #include "settings.h"
-#include <fstream>
 #include <shlobj.h>
 #include <filesystem>
+#include <array>
+#include <charconv>
+#include <algorithm>
+#include "../common/presetSink.h"
+#include "../common/mappedFile.h"
+
+enum class SettingType {
+    Bool,
+    Int,
+    Float,
+    String
+};
+
+// One entry of the settings schema
+struct SettingField {
+    std::string_view name;
+    SettingType type;
+    unsigned field;
+
+    // Member the entry describes; only the one matching type is set
+    bool SettingsValues::* boolMember;
+    int SettingsValues::* intMember;
+    float SettingsValues::* floatMember;
+    std::string SettingsValues::* stringMember;
+
+    // Default and accepted range
+    bool boolDefault;
+    int intDefault;
+    int intMin;
+    int intMax;
+    float floatDefault;
+    float floatMin;
+    float floatMax;
+    std::string_view stringDefault;
+};
+
+static constexpr SettingField boolSetting(std::string_view name, unsigned field,
+    bool SettingsValues::* member, bool defaultValue) {
+    return { name, SettingType::Bool, field, member, nullptr, nullptr, nullptr, defaultValue, 0, 0, 0, 0.0f, 0.0f, 0.0f, {} };
+}
+
+static constexpr SettingField intSetting(std::string_view name, unsigned field,
+    int SettingsValues::* member, int defaultValue, int minValue, int maxValue) {
+    return { name, SettingType::Int, field, nullptr, member, nullptr, nullptr, false, defaultValue, minValue, maxValue, 0.0f, 0.0f, 0.0f, {} };
+}
+
+static constexpr SettingField floatSetting(std::string_view name, unsigned field,
+    float SettingsValues::* member, float defaultValue, float minValue, float maxValue) {
+    return { name, SettingType::Float, field, nullptr, nullptr, member, nullptr, false, 0, 0, 0, defaultValue, minValue, maxValue, {} };
+}
+
+static constexpr SettingField stringSetting(std::string_view name, unsigned field,
+    std::string SettingsValues::* member, std::string_view defaultValue) {
+    return { name, SettingType::String, field, nullptr, nullptr, nullptr, member, false, 0, 0, 0, 0.0f, 0.0f, 0.0f, defaultValue };
+}
+
+// Every setting, in the order they are written to the file
+static constexpr std::array s_settingFields = {
+    boolSetting("StartWithWindows", Settings::FIELD_START_WITH_WINDOWS, &SettingsValues::startWithWindows, false),
+    boolSetting("StartMinimized", Settings::FIELD_START_MINIMIZED, &SettingsValues::startMinimized, false),
+    floatSetting("CrosshairScale", Settings::FIELD_CROSSHAIR_SCALE, &SettingsValues::crosshairScale, 1.0f, 0.5f, 5.0f),
+    stringSetting("LastLoadedPreset", Settings::FIELD_LAST_LOADED_PRESET, &SettingsValues::lastLoadedPreset, "Default"),
+    boolSetting("UsePresetLibrary", Settings::FIELD_USE_PRESET_LIBRARY, &SettingsValues::usePresetLibrary, false),
+    intSetting("PresetCacheMB", Settings::FIELD_PRESET_CACHE_MB, &SettingsValues::presetCacheMB, 64, 1, 1024),
+    intSetting("UndoHistoryMB", Settings::FIELD_UNDO_HISTORY_MB, &SettingsValues::undoHistoryMB, 16, 1, 256),
+};
+
+static constexpr unsigned ALL_FIELDS = (1u << s_settingFields.size()) - 1;
+
+// getChangedFields() bits follow the table order
+static constexpr bool fieldBitsMatchOrder() {
+    for (size_t i = 0; i < s_settingFields.size(); i++) {
+        if (s_settingFields[i].field != 1u << i) return false;
+    }
+    return true;
+}
+
+static_assert(fieldBitsMatchOrder(), "Settings::FIELD_* must match the schema order");
+
+static constexpr uint32_t hashKey(std::string_view key, uint32_t seed) {
+    // FNV-1a
+    uint32_t hash = 2166136261u ^ seed;
+    for (char c : key) {
+        hash ^= (uint8_t)c;
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+// Perfect hash over the setting names: the seed is searched for at compile
+// time so that every name lands in its own slot
+struct SettingKeyIndex {
+    static constexpr size_t SLOT_COUNT = 16;
+
+    uint32_t seed;
+    std::array<int8_t, SLOT_COUNT> slots;
+};
+
+static_assert(s_settingFields.size() * 2 <= SettingKeyIndex::SLOT_COUNT, "Grow SLOT_COUNT with the schema");
+
+static constexpr SettingKeyIndex makeSettingKeyIndex() {
+    for (uint32_t seed = 0;; seed++) {
+        SettingKeyIndex index{ seed, {} };
+        index.slots.fill(-1);
+
+        bool collided = false;
+        for (size_t i = 0; i < s_settingFields.size() && !collided; i++) {
+            int8_t& slot = index.slots[hashKey(s_settingFields[i].name, seed) % SettingKeyIndex::SLOT_COUNT];
+            collided = slot >= 0;
+            slot = (int8_t)i;
+        }
+
+        if (!collided) {
+            return index;
+        }
+    }
+}
+
+static constexpr SettingKeyIndex s_settingKeys = makeSettingKeyIndex();
+
+static const SettingField* findSetting(std::string_view key) {
+    int8_t slot = s_settingKeys.slots[hashKey(key, s_settingKeys.seed) % SettingKeyIndex::SLOT_COUNT];
+    if (slot < 0 || s_settingFields[slot].name != key) {
+        return nullptr;
+    }
+    return &s_settingFields[slot];
+}
+
+static void applyDefault(SettingsValues& values, const SettingField& setting) {
+    switch (setting.type) {
+    case SettingType::Bool:
+        values.*setting.boolMember = setting.boolDefault;
+        break;
+    case SettingType::Int:
+        values.*setting.intMember = setting.intDefault;
+        break;
+    case SettingType::Float:
+        values.*setting.floatMember = setting.floatDefault;
+        break;
+    case SettingType::String:
+        values.*setting.stringMember = setting.stringDefault;
+        break;
+    }
+}
+
+static bool settingEquals(const SettingsValues& a, const SettingsValues& b, const SettingField& setting) {
+    switch (setting.type) {
+    case SettingType::Bool:
+        return a.*setting.boolMember == b.*setting.boolMember;
+    case SettingType::Int:
+        return a.*setting.intMember == b.*setting.intMember;
+    case SettingType::Float:
+        return a.*setting.floatMember == b.*setting.floatMember;
+    case SettingType::String:
+        return a.*setting.stringMember == b.*setting.stringMember;
+    }
+    return true;
+}
 
 Settings::Settings()
-    : startWithWindows(false)
-    , startMinimized(false)
-    , crosshairScale(1.0f)
-    , lastLoadedPreset("Default") {
+    : m_writtenValid(false)
+    , m_savePending(false)
+    , m_saveFailures(0)
+    , m_stats() {
+    for (const SettingField& setting : s_settingFields) {
+        applyDefault(*this, setting);
+    }
+
     // Load settings from file
     load();
 }
 
 Settings::~Settings() {
-    // Save settings when the application exits
-    save();
 }
 
 std::string Settings::getSettingsPath() const {
@@ -37,58 +196,216 @@ std::string Settings::getSettingsPath() const {
 }
 
 bool Settings::load() {
-    std::string path = getSettingsPath();
-    std::ifstream file(path);
-
-    if (!file.is_open()) {
+    MappedFile file;
+    if (!file.open(getSettingsPath())) {
         // If file doesn't exist, use default settings
         return false;
     }
 
-    std::string line;
-    while (std::getline(file, line)) {
+    std::string_view data = file.getData();
+    while (!data.empty()) {
+        size_t lineEnd = data.find('\n');
+        std::string_view line = data.substr(0, lineEnd);
+        data.remove_prefix(lineEnd == std::string_view::npos ? data.size() : lineEnd + 1);
+
+        // Files written in text mode end lines with \r\n
+        if (!line.empty() && line.back() == '\r') {
+            line.remove_suffix(1);
+        }
+
         size_t delimPos = line.find('=');
-        if (delimPos != std::string::npos) {
-            std::string key = line.substr(0, delimPos);
-            std::string value = line.substr(delimPos + 1);
-
-            if (key == "StartWithWindows") {
-                startWithWindows = (value == "true");
-            }
-            else if (key == "StartMinimized") {
-                startMinimized = (value == "true");
-            }
-            else if (key == "CrosshairScale") {
-                try {
-                    crosshairScale = std::stof(value);
-                }
-                catch (...) {
-                    crosshairScale = 1.0f;
-                }
-            }
-            else if (key == "LastLoadedPreset") {
-                lastLoadedPreset = value;
-            }
+        if (delimPos != std::string_view::npos) {
+            parseSetting(line.substr(0, delimPos), line.substr(delimPos + 1));
         }
     }
 
-    file.close();
+    markWritten();
     return true;
 }
 
+bool Settings::parseSetting(std::string_view key, std::string_view value) {
+    const SettingField* setting = findSetting(key);
+    if (!setting) {
+        return false;
+    }
+
+    switch (setting->type) {
+    case SettingType::Bool:
+        this->*setting->boolMember = (value == "true");
+        break;
+    case SettingType::Int: {
+        int parsed = 0;
+        auto [end, error] = std::from_chars(value.data(), value.data() + value.size(), parsed);
+        if (error != std::errc() || parsed < setting->intMin || parsed > setting->intMax) {
+            parsed = setting->intDefault;
+        }
+        this->*setting->intMember = parsed;
+        break;
+    }
+    case SettingType::Float: {
+        float parsed = 0.0f;
+        auto [end, error] = std::from_chars(value.data(), value.data() + value.size(), parsed);
+        if (error != std::errc() || !(parsed >= setting->floatMin && parsed <= setting->floatMax)) {
+            parsed = setting->floatDefault;
+        }
+        this->*setting->floatMember = parsed;
+        break;
+    }
+    case SettingType::String:
+        (this->*setting->stringMember).assign(value);
+        break;
+    }
+
+    return true;
+}
+
+// Replace the settings file in one step
+static bool writeSettingsFile(const std::string& path, const std::string& text) {
+    if (path.empty()) {
+        return false;
+    }
+
+    return FileSink::writeAtomic(path, [&](PresetSink& sink) {
+        sink.write(text.data(), text.size());
+    });
+}
+
+std::string Settings::toText() const {
+    std::string text;
+
+    for (const SettingField& setting : s_settingFields) {
+        text.append(setting.name);
+        text.push_back('=');
+
+        switch (setting.type) {
+        case SettingType::Bool:
+            text.append(this->*setting.boolMember ? "true" : "false");
+            break;
+        case SettingType::Int: {
+            char number[16];
+            auto [end, error] = std::to_chars(number, number + sizeof(number), this->*setting.intMember);
+            text.append(number, end);
+            break;
+        }
+        case SettingType::Float: {
+            char number[32];
+            auto [end, error] = std::to_chars(number, number + sizeof(number), this->*setting.floatMember);
+            text.append(number, end);
+            break;
+        }
+        case SettingType::String:
+            text.append(this->*setting.stringMember);
+            break;
+        }
+
+        text.push_back('\n');
+    }
+
+    return text;
+}
+
 bool Settings::save() {
+    m_savePending = false;
+
+    bool written = writeSettingsFile(getSettingsPath(), toText());
+    m_stats.writes++;
+    if (written) {
+        markWritten();
+    }
+    return written;
+}
+
+void Settings::saveAsync(IoWorker& worker) {
+    m_stats.requests++;
+    m_savePending = false;
+
+    if (getChangedFields() == 0) {
+        m_stats.clean++;
+        return;
+    }
+
+    // Snapshot now; a newer save still queued replaces this one
     std::string path = getSettingsPath();
-    std::ofstream file(path);
+    std::string text = toText();
+    markWritten();
+    m_stats.writes++;
 
-    if (!file.is_open()) {
+    worker.submit("settings", [path, text]() {
+        return writeSettingsFile(path, text);
+    }, [this](bool written) {
+        if (written) {
+            m_saveFailures = 0;
+            return;
+        }
+
+        // The file may have been open elsewhere (a reload mapping it, a virus
+        // scanner): write everything again shortly, unless it keeps failing
+        m_stats.failed++;
+        m_writtenValid = false;
+        if (++m_saveFailures <= MAX_SAVE_RETRIES && !m_savePending) {
+            m_stats.requests++;
+            m_savePending = true;
+            m_saveDue = std::chrono::steady_clock::now() + std::chrono::milliseconds(SAVE_DELAY_MS);
+        }
+    });
+}
+
+void Settings::requestSave() {
+    m_stats.requests++;
+
+    if (m_savePending) {
+        m_stats.merged++;
+    }
+    else if (getChangedFields() == 0) {
+        m_stats.clean++;
+        return;
+    }
+
+    m_savePending = true;
+    m_saveDue = std::chrono::steady_clock::now() + std::chrono::milliseconds(SAVE_DELAY_MS);
+}
+
+void Settings::update(IoWorker& worker) {
+    if (!m_savePending || std::chrono::steady_clock::now() < m_saveDue) {
+        return;
+    }
+
+    // Already counted as a request when it was made
+    m_stats.requests--;
+    saveAsync(worker);
+}
+
+bool Settings::flush() {
+    m_savePending = false;
+
+    if (getChangedFields() == 0) {
+        return true;
+    }
+    return save();
+}
+
+bool Settings::reload() {
+    if (m_savePending || getChangedFields() != 0) {
         return false;
     }
+    return load();
+}
 
-    file << "StartWithWindows=" << (startWithWindows ? "true" : "false") << std::endl;
-    file << "StartMinimized=" << (startMinimized ? "true" : "false") << std::endl;
-    file << "CrosshairScale=" << crosshairScale << std::endl;
-    file << "LastLoadedPreset=" << lastLoadedPreset << std::endl;
+unsigned Settings::getChangedFields() const {
+    if (!m_writtenValid) {
+        return ALL_FIELDS;
+    }
 
-    file.close();
-    return true;
-}
\ No newline at end of file
+    unsigned changed = 0;
+    for (const SettingField& setting : s_settingFields) {
+        if (!settingEquals(*this, m_written, setting)) {
+            changed |= setting.field;
+        }
+    }
+    return changed;
+}
+
+void Settings::markWritten() {
+    m_written = *this;
+    m_writtenValid = true;
+}
@@ -1,26 +1,90 @@
 #pragma once
 
 #include <string>
+#include <string_view>
 #include <memory>
 #include <vector>
+#include <chrono>
+#include <cstdint>
 #include "../common/crosshair.h"
+#include "../common/ioWorker.h"
 
-class Settings {
+// Application settings. Each field is described once, by the schema in
+// settings.cpp, which drives defaults, parsing and serialization.
+struct SettingsValues {
+    bool startWithWindows;
+    bool startMinimized;
+    float crosshairScale;
+    std::string lastLoadedPreset;
+    bool usePresetLibrary;
+    int presetCacheMB;
+    int undoHistoryMB;
+};
+
+class Settings : public SettingsValues {
 public:
+    // Bits of getChangedFields()
+    static constexpr unsigned FIELD_START_WITH_WINDOWS = 1 << 0;
+    static constexpr unsigned FIELD_START_MINIMIZED = 1 << 1;
+    static constexpr unsigned FIELD_CROSSHAIR_SCALE = 1 << 2;
+    static constexpr unsigned FIELD_LAST_LOADED_PRESET = 1 << 3;
+    static constexpr unsigned FIELD_USE_PRESET_LIBRARY = 1 << 4;
+    static constexpr unsigned FIELD_PRESET_CACHE_MB = 1 << 5;
+    static constexpr unsigned FIELD_UNDO_HISTORY_MB = 1 << 6;
+
+    // How long requestSave() waits for further changes before writing
+    static constexpr int SAVE_DELAY_MS = 500;
+
+    // Times a failed background write is tried again, SAVE_DELAY_MS apart
+    static constexpr int MAX_SAVE_RETRIES = 5;
+
+    struct SaveStats {
+        uint64_t requests;  // requestSave() and saveAsync() calls
+        uint64_t writes;    // Times the file was written
+        uint64_t clean;     // Requests dropped because nothing had changed
+        uint64_t merged;    // Requests folded into a pending debounced write
+        uint64_t failed;    // Writes that did not reach the file
+    };
+
     Settings();
+
+    // Not saved here: static destruction runs too late to write safely, so
+    // the application calls flush() during shutdown instead
     ~Settings();
 
     // Load settings from file
     bool load();
 
-    // Save settings to file
+    // Save settings to file, replacing it atomically
     bool save();
 
-    // Application settings
-    bool startWithWindows;
-    bool startMinimized;
-    float crosshairScale;
-    std::string lastLoadedPreset;
+    // Save from the I/O worker if anything changed; the values are captured
+    // when this is called
+    void saveAsync(IoWorker& worker);
+
+    // Save once the settings have been left alone for SAVE_DELAY_MS. Cheap
+    // enough to call on every change; update() does the write.
+    void requestSave();
+
+    // Start a requested save that is due; call once per frame
+    void update(IoWorker& worker);
+
+    // Write any unsaved change now, on the calling thread
+    bool flush();
+
+    // Read the file again after it changed on disk. Skipped while there are
+    // unsaved changes, which win over the file.
+    bool reload();
+
+    // Fields that differ from the file as last written (all of them if the
+    // file was never read or written successfully)
+    unsigned getChangedFields() const;
+
+    const SaveStats& getSaveStats() const { return m_stats; }
+
+    // Apply one "key=value" setting, ignoring unknown keys. Values that do not
+    // parse or are out of range fall back to the default.
+    bool parseSetting(std::string_view key, std::string_view value);
 
     // Get singleton instance
     static Settings& getInstance() {
@@ -29,5 +93,24 @@ public:
     }
 
 private:
+    // Values in the file, valid once it has been read or written
+    SettingsValues m_written;
+    bool m_writtenValid;
+
+    // Debounced save requested by requestSave()
+    bool m_savePending;
+    std::chrono::steady_clock::time_point m_saveDue;
+
+    // Background writes that failed since the last one that succeeded
+    int m_saveFailures;
+
+    SaveStats m_stats;
+
     std::string getSettingsPath() const;
+
+    // Contents of the settings file
+    std::string toText() const;
+
+    // Record the current values as written
+    void markWritten();
 };
\ No newline at end of file
@@ -0,0 +1,128 @@
+#include "dx11Texture.h"
+#include <../ext/ImGui/imgui.h>
+#include <../ext/ImGui/imgui_impl_dx11.h>
+
+Dx11Texture::Dx11Texture(ID3D11Device* device, ID3D11DeviceContext* deviceContext)
+    : m_pDevice(device), m_pDeviceContext(deviceContext),
+    m_pTexture(nullptr), m_pTextureView(nullptr), m_pPointSampler(nullptr),
+    m_width(0), m_height(0) {
+    // Point sampling keeps crosshair pixels sharp at any scale
+    D3D11_SAMPLER_DESC desc;
+    ZeroMemory(&desc, sizeof(desc));
+    desc.Filter = D3D11_FILTER_MIN_MAG_MIP_POINT;
+    desc.AddressU = D3D11_TEXTURE_ADDRESS_CLAMP;
+    desc.AddressV = D3D11_TEXTURE_ADDRESS_CLAMP;
+    desc.AddressW = D3D11_TEXTURE_ADDRESS_CLAMP;
+    desc.ComparisonFunc = D3D11_COMPARISON_ALWAYS;
+    desc.MaxLOD = D3D11_FLOAT32_MAX;
+    m_pDevice->CreateSamplerState(&desc, &m_pPointSampler);
+}
+
+Dx11Texture::~Dx11Texture() {
+    releaseTexture();
+    if (m_pPointSampler) { m_pPointSampler->Release(); m_pPointSampler = nullptr; }
+}
+
+bool Dx11Texture::createTexture(int width, int height) {
+    releaseTexture();
+
+    D3D11_TEXTURE2D_DESC desc;
+    ZeroMemory(&desc, sizeof(desc));
+    desc.Width = width;
+    desc.Height = height;
+    desc.MipLevels = 1;
+    desc.ArraySize = 1;
+    desc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
+    desc.SampleDesc.Count = 1;
+    desc.Usage = D3D11_USAGE_DEFAULT;
+    desc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+
+    if (FAILED(m_pDevice->CreateTexture2D(&desc, nullptr, &m_pTexture))) {
+        return false;
+    }
+
+    D3D11_SHADER_RESOURCE_VIEW_DESC srvDesc;
+    ZeroMemory(&srvDesc, sizeof(srvDesc));
+    srvDesc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
+    srvDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2D;
+    srvDesc.Texture2D.MipLevels = 1;
+
+    if (FAILED(m_pDevice->CreateShaderResourceView(m_pTexture, &srvDesc, &m_pTextureView))) {
+        releaseTexture();
+        return false;
+    }
+
+    m_width = width;
+    m_height = height;
+    return true;
+}
+
+void Dx11Texture::releaseTexture() {
+    if (m_pTextureView) { m_pTextureView->Release(); m_pTextureView = nullptr; }
+    if (m_pTexture) { m_pTexture->Release(); m_pTexture = nullptr; }
+    m_width = 0;
+    m_height = 0;
+}
+
+bool Dx11Texture::upload(int width, int height, int x, int y, int w, int h, const uint32_t* pixels, int pitch) {
+    if (width <= 0 || height <= 0) return false;
+
+    if (!m_pTexture || width != m_width || height != m_height) {
+        if (!createTexture(width, height)) {
+            return false;
+        }
+    }
+
+    if (w <= 0 || h <= 0) return true;
+
+    // Only the dirty sub-rectangle is copied to the GPU
+    D3D11_BOX box;
+    box.left = x;
+    box.top = y;
+    box.front = 0;
+    box.right = x + w;
+    box.bottom = y + h;
+    box.back = 1;
+
+    m_pDeviceContext->UpdateSubresource(m_pTexture, 0, &box, pixels, pitch * sizeof(uint32_t), 0);
+
+    return true;
+}
+
+void Dx11Texture::draw(ImDrawList* drawList, float minX, float minY, float maxX, float maxY) {
+    drawRegion(drawList, minX, minY, maxX, maxY, 0, 0, m_width, m_height);
+}
+
+void Dx11Texture::drawRegion(ImDrawList* drawList, float minX, float minY, float maxX, float maxY,
+    int x, int y, int w, int h) {
+    if (!m_pTextureView) return;
+
+    beginRegions(drawList);
+    addRegion(drawList, minX, minY, maxX, maxY, x, y, w, h);
+    endRegions(drawList);
+}
+
+void Dx11Texture::beginRegions(ImDrawList* drawList) {
+    drawList->AddCallback(setPointSampler, m_pPointSampler);
+}
+
+void Dx11Texture::addRegion(ImDrawList* drawList, float minX, float minY, float maxX, float maxY,
+    int x, int y, int w, int h) {
+    if (!m_pTextureView) return;
+
+    ImVec2 uvMin((float)x / m_width, (float)y / m_height);
+    ImVec2 uvMax((float)(x + w) / m_width, (float)(y + h) / m_height);
+    drawList->AddImage((ImTextureID)(intptr_t)m_pTextureView, ImVec2(minX, minY), ImVec2(maxX, maxY), uvMin, uvMax);
+}
+
+void Dx11Texture::endRegions(ImDrawList* drawList) {
+    drawList->AddCallback(ImDrawCallback_ResetRenderState, nullptr);
+}
+
+void Dx11Texture::setPointSampler(const ImDrawList* parentList, const ImDrawCmd* cmd) {
+    ImGui_ImplDX11_RenderState* renderState = (ImGui_ImplDX11_RenderState*)ImGui::GetPlatformIO().Renderer_RenderState;
+    if (!renderState) return;
+
+    ID3D11SamplerState* sampler = (ID3D11SamplerState*)cmd->UserCallbackData;
+    renderState->DeviceContext->PSSetSamplers(0, 1, &sampler);
+}
\ No newline at end of file
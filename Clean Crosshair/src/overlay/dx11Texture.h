@@ -0,0 +1,51 @@
+#pragma once
+
+#include <d3d11.h>
+#include "../common/pixelTexture.h"
+
+struct ImDrawCmd;
+
+// Direct3D 11 implementation of PixelTexture
+class Dx11Texture : public PixelTexture {
+public:
+    Dx11Texture(ID3D11Device* device, ID3D11DeviceContext* deviceContext);
+    ~Dx11Texture();
+
+    int getWidth() const override { return m_width; }
+    int getHeight() const override { return m_height; }
+
+    // Upload a sub-rectangle of the image (recreates the texture on size change)
+    bool upload(int width, int height, int x, int y, int w, int h, const uint32_t* pixels, int pitch) override;
+
+    // Draw with point sampling, restoring the default render state afterwards
+    void draw(ImDrawList* drawList, float minX, float minY, float maxX, float maxY) override;
+
+    // Draw part of the texture, e.g. one thumbnail of an atlas
+    void drawRegion(ImDrawList* drawList, float minX, float minY, float maxX, float maxY,
+        int x, int y, int w, int h) override;
+
+    // Draw several parts between one sampler callback and one render state reset
+    void beginRegions(ImDrawList* drawList) override;
+    void addRegion(ImDrawList* drawList, float minX, float minY, float maxX, float maxY,
+        int x, int y, int w, int h) override;
+    void endRegions(ImDrawList* drawList) override;
+
+private:
+    ID3D11Device* m_pDevice;
+    ID3D11DeviceContext* m_pDeviceContext;
+    ID3D11Texture2D* m_pTexture;
+    ID3D11ShaderResourceView* m_pTextureView;
+    ID3D11SamplerState* m_pPointSampler;
+
+    int m_width;
+    int m_height;
+
+    // Create texture and shader resource view for the given dimensions
+    bool createTexture(int width, int height);
+
+    // Release texture resources
+    void releaseTexture();
+
+    // Draw callback binding the point sampler passed as user data
+    static void setPointSampler(const ImDrawList* parentList, const ImDrawCmd* cmd);
+};
\ No newline at end of file
@@ -19,7 +19,7 @@ extern IMGUI_IMPL_API LRESULT ImGui_ImplWin32_WndProcHandler(HWND hWnd, UINT msg
 Overlay::Overlay()
     : m_hWnd(nullptr), m_running(false),
     m_pDevice(nullptr), m_pDeviceContext(nullptr), m_pSwapChain(nullptr), m_pRenderTargetView(nullptr),
-    m_width(0), m_height(0), m_trayIconAdded(false) {
+    m_presetKeyDown(), m_width(0), m_height(0), m_trayIconAdded(false) {
 }
 
 Overlay::~Overlay() {
@@ -54,11 +54,21 @@ bool Overlay::initialize() {
     m_crosshair = std::make_shared<Crosshair>();
     m_crosshair->initDefault();
 
+    // Draw the crosshair from a single texture instead of per-pixel geometry
+    m_crosshairTexture = std::make_shared<Dx11Texture>(m_pDevice, m_pDeviceContext);
+    m_crosshair->setTexture(m_crosshairTexture);
+
     // Initialize editor window
     m_editorWindow = std::make_unique<EditorWindow>();
     m_editorWindow->initialize();
     m_editorWindow->setCrosshair(m_crosshair);
 
+    // The preset list draws every thumbnail from one atlas texture
+    m_editorWindow->setThumbnailTexture(std::make_shared<Dx11Texture>(m_pDevice, m_pDeviceContext));
+
+    // The editor grid is one texture too, updated where the pixels change
+    m_editorWindow->setCanvasTexture(std::make_shared<Dx11Texture>(m_pDevice, m_pDeviceContext));
+
     // Set callbacks
     m_editorWindow->setCloseCallback([this]() {
         // Do nothing when editor is closed, just hide it
@@ -106,9 +116,20 @@ void Overlay::run() {
 }
 
 void Overlay::shutdown() {
+    // Finish pending writes while everything is still alive
+    if (m_editorWindow) {
+        m_editorWindow->shutdown();
+    }
+
     // Remove tray icon
     removeTrayIcon();
 
+    // Release the crosshair texture while the device is still alive
+    if (m_crosshair) {
+        m_crosshair->setTexture(nullptr);
+    }
+    m_crosshairTexture.reset();
+
     // Clean up ImGui
     ImGui_ImplDX11_Shutdown();
     ImGui_ImplWin32_Shutdown();
@@ -232,7 +253,26 @@ void Overlay::cleanupDirect3D() {
 }
 
 void Overlay::update() {
-    // Update logic here if needed
+    // Apply preset loads and saves that finished in the background
+    if (m_editorWindow) {
+        m_editorWindow->update();
+    }
+
+    pollPresetHotkeys();
+}
+
+void Overlay::pollPresetHotkeys() {
+    static constexpr int PRESET_KEYS[2] = { VK_NEXT, VK_PRIOR };
+    static constexpr int PRESET_STEPS[2] = { 1, -1 };
+
+    bool modifiers = (GetAsyncKeyState(VK_CONTROL) & 0x8000) && (GetAsyncKeyState(VK_MENU) & 0x8000);
+    for (int i = 0; i < 2; i++) {
+        bool down = modifiers && (GetAsyncKeyState(PRESET_KEYS[i]) & 0x8000);
+        if (down && !m_presetKeyDown[i] && m_editorWindow) {
+            m_editorWindow->cyclePreset(PRESET_STEPS[i]);
+        }
+        m_presetKeyDown[i] = down;
+    }
 }
 
 void Overlay::render() {
@@ -6,6 +6,7 @@
 #include <d3d11.h>
 #include "../common/crosshair.h"
 #include "../editor/editorWindow.h"
+#include "dx11Texture.h"
 
 // Define custom message for system tray
 #define WM_TRAYICON (WM_USER + 1)
@@ -61,6 +62,9 @@ private:
     // Toggle editor window visibility
     void toggleEditor();
 
+    // Cycle presets on Ctrl+Alt+Page Down / Page Up, whichever window has focus
+    void pollPresetHotkeys();
+
 private:
     HWND m_hWnd;
     WNDCLASSEX m_wc;
@@ -75,9 +79,15 @@ private:
     // Crosshair data
     std::shared_ptr<Crosshair> m_crosshair;
 
+    // GPU texture the crosshair is drawn from
+    std::shared_ptr<Dx11Texture> m_crosshairTexture;
+
     // Editor window
     std::unique_ptr<EditorWindow> m_editorWindow;
 
+    // Whether each preset hotkey was down last frame, so holding one cycles once
+    bool m_presetKeyDown[2];
+
     // Window dimensions
     int m_width;
     int m_height;
@@ -0,0 +1,114 @@
+// Times what CoveragePlane's fixed 32, 64 and 128 pixel masks are meant to
+// speed up: a span scan of every row, building the draw mesh, clearing, and
+// serializing. Each fixed size N is compared with N - 1, which has the same
+// words per row but stays on the dynamic mask; its times are scaled up to N * N
+// pixels. Built as its own console program (see Coverage Plane Benchmark.vcxproj).
+#include "common/crosshair.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+
+static constexpr int PASSES = 5;
+static const Color WHITE(255, 255, 255, 255);
+
+// A plus with arms a quarter of the grid long, three pixels thick
+static void drawPlus(Crosshair& crosshair) {
+    int size = crosshair.getSize();
+    int center = size / 2;
+    int arm = size / 4;
+    crosshair.clear();
+    crosshair.fillRect(PixelRect(center - arm, center - 1, center + arm, center + 2), WHITE);
+    crosshair.fillRect(PixelRect(center - 1, center - arm, center + 2, center + arm), WHITE);
+}
+
+// Nanoseconds per call of work, best of several rounds
+template <typename Work>
+static double timeNanos(int pixels, Work work) {
+    int calls = std::max(4, (1 << 20) / pixels);
+    double best = 1e30;
+    for (int round = 0; round < 15; round++) {
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < calls; i++) {
+            work();
+        }
+        std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+        best = std::min(best, elapsed.count() / calls);
+    }
+    return best;
+}
+
+struct Timings {
+    double spans;
+    double draw;
+    double clear;
+    double serialize;
+};
+
+static Timings measure(int size) {
+    Crosshair crosshair;
+    crosshair.resize(size);
+    int pixels = size * size;
+    Timings timings;
+
+    drawPlus(crosshair);
+    long long covered = 0;
+    timings.spans = timeNanos(pixels, [&]() {
+        for (int y = 0; y < size; y++) {
+            crosshair.forEachOpaqueSpan(y, [&](int startX, int endX) { covered += endX - startX; });
+        }
+    });
+
+    // One pixel toggled each time so the whole mesh is rebuilt
+    bool on = false;
+    timings.draw = timeNanos(pixels, [&]() {
+        on = !on;
+        crosshair.setPixel(0, 0, on ? WHITE : Color(0, 0, 0, 0));
+        crosshair.getMeshVertexCount();
+    });
+
+    // A full-grid fill and the clear that empties it again
+    timings.clear = timeNanos(pixels, [&]() {
+        crosshair.fillRect(PixelRect(0, 0, size, size), WHITE);
+        crosshair.clear();
+    });
+
+    drawPlus(crosshair);
+    size_t length = 0;
+    timings.serialize = timeNanos(pixels, [&]() { length += crosshair.serialize().size(); });
+
+    // Keep the results alive
+    if (covered == 0 || length == 0) printf("nothing measured at %d\n", size);
+    return timings;
+}
+
+static void keepBest(Timings& best, const Timings& timings) {
+    best.spans = std::min(best.spans, timings.spans);
+    best.draw = std::min(best.draw, timings.draw);
+    best.clear = std::min(best.clear, timings.clear);
+    best.serialize = std::min(best.serialize, timings.serialize);
+}
+
+static void report(const char* name, double fixed, double dynamic) {
+    printf("  %-10s %10.0f %10.0f %+8.1f%%\n", name, fixed, dynamic, (fixed / dynamic - 1) * 100);
+}
+
+int main() {
+    printf("ns per call   fixed N    N-1 (as N*N)   change\n");
+    for (int size : { 32, 64, 128 }) {
+        // Alternate the two sizes so both see the same machine noise
+        Timings fixed = measure(size);
+        Timings dynamic = measure(size - 1);
+        for (int pass = 1; pass < PASSES; pass++) {
+            keepBest(fixed, measure(size));
+            keepBest(dynamic, measure(size - 1));
+        }
+        double scale = (double)size * size / ((size - 1) * (size - 1));
+
+        printf("%dx%d vs %dx%d\n", size, size, size - 1, size - 1);
+        report("spans", fixed.spans, dynamic.spans * scale);
+        report("draw", fixed.draw, dynamic.draw * scale);
+        report("clear", fixed.clear, dynamic.clear * scale);
+        report("serialize", fixed.serialize, dynamic.serialize * scale);
+    }
+    return 0;
+}
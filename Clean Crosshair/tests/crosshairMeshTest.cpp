@@ -0,0 +1,74 @@
+// Counts the vertices of Crosshair's merged draw mesh against one quad per
+// opaque pixel, the way draw() worked before the mesh was cached. Built as
+// its own console program (see Crosshair Mesh Test.vcxproj), no window or
+// renderer needed. Exits with 1 if a count differs from the expected one.
+#include "common/crosshair.h"
+#include <cstdio>
+
+static const Color WHITE(255, 255, 255, 255);
+
+static void drawCircle(Crosshair& crosshair, int radius) {
+    int center = crosshair.getSize() / 2;
+    crosshair.beginBatch();
+    for (int y = center - radius; y <= center + radius; y++) {
+        for (int x = center - radius; x <= center + radius; x++) {
+            int dx = x - center;
+            int dy = y - center;
+            if (dx * dx + dy * dy <= radius * radius) {
+                crosshair.setPixel(x, y, WHITE);
+            }
+        }
+    }
+    crosshair.commitBatch();
+}
+
+static void drawCheckerboard(Crosshair& crosshair) {
+    int size = crosshair.getSize();
+    crosshair.beginBatch();
+    for (int y = 0; y < size; y++) {
+        for (int x = (y & 1); x < size; x += 2) {
+            crosshair.setPixel(x, y, WHITE);
+        }
+    }
+    crosshair.commitBatch();
+}
+
+static bool check(const char* name, Crosshair& crosshair, int expected) {
+    int perPixel = crosshair.getOpaqueCount() * 4;
+    int merged = crosshair.getMeshVertexCount();
+    printf("%-14s %6d pixels %7d -> %5d vertices\n", name, crosshair.getOpaqueCount(), perPixel, merged);
+    if (merged != expected) {
+        printf("MISMATCH %s: expected %d vertices\n", name, expected);
+        return false;
+    }
+    return true;
+}
+
+int main() {
+    bool passed = true;
+
+    // Two bars with a gap in the middle: four rectangles
+    Crosshair defaultPreset;
+    defaultPreset.initDefault();
+    passed &= check("default", defaultPreset, 16);
+
+    Crosshair rect;
+    rect.fillRect(PixelRect(8, 8, 56, 56), WHITE);
+    passed &= check("filled rect", rect, 4);
+
+    // One rectangle per band of rows with the same width
+    Crosshair circle;
+    drawCircle(circle, 20);
+    passed &= check("filled circle", circle, 100);
+
+    // Nothing can merge, so the mesh is as large as one quad per pixel
+    Crosshair checkerboard;
+    drawCheckerboard(checkerboard);
+    passed &= check("checkerboard", checkerboard, checkerboard.getOpaqueCount() * 4);
+
+    // The mesh follows edits: clearing one pixel splits the rectangle
+    rect.setPixel(30, 30, Color(0, 0, 0, 0));
+    passed &= check("rect, 1 hole", rect, 16);
+
+    return passed ? 0 : 1;
+}
@@ -0,0 +1,180 @@
+// Records 1000 edits of every kind into an EditHistory (strokes, rects, color
+// swaps, fades, clears and resizes), then steps back through all of them, forward
+// again, and jumps to random positions, checking each time that the grid is
+// exactly what that entry left. Every step is timed against a 60 Hz frame up
+// to FRAME_CHECK_SIZE; a 1024x1024 grid is only reported, since every
+// whole-grid step there rewrites a million pixels. Built as its own console
+// program (see Edit History Test.vcxproj). Exits with 1 if a grid differs, an
+// entry was dropped, or a step took a frame.
+#include "common/crosshair.h"
+#include "editor/editHistory.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+static constexpr int GRID_SIZES[] = { 64, 256, 1024 };
+static constexpr int ENTRIES = 1000;
+static constexpr int JUMPS = 200;
+static constexpr double FRAME_MICROS = 1000000.0 / 60;
+static constexpr int FRAME_CHECK_SIZE = 256;
+
+static const Color COLORS[] = {
+    Color(255, 255, 255, 255), Color(255, 0, 0, 255), Color(0, 255, 0, 160), Color(0, 0, 0, 0)
+};
+
+struct Timings {
+    std::vector<double> micros;
+
+    void add(std::chrono::steady_clock::time_point start) {
+        micros.push_back(std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count());
+    }
+
+    double percentile(int p) {
+        std::sort(micros.begin(), micros.end());
+        return micros[(micros.size() - 1) * p / 100];
+    }
+};
+
+// One edit of a kind the editor makes, chosen at random
+static void edit(Crosshair& crosshair, std::mt19937& random, int step) {
+    int size = crosshair.getSize();
+    const Color& color = COLORS[random() % 4];
+
+    // Now and then the grid is resized and later put back
+    if (step % 250 == 125) {
+        crosshair.resize(size + 16);
+        return;
+    }
+    if (step % 250 == 249 && size % 64 != 0) {
+        crosshair.resize(size - 16);
+        return;
+    }
+
+    switch (random() % 10) {
+    case 0:
+    case 1:
+    case 2:
+    case 3: {
+        // Pencil stroke: a short random walk
+        int x = random() % size, y = random() % size;
+        crosshair.beginBatch();
+        for (int i = 0, count = 1 + random() % 40; i < count; i++) {
+            crosshair.setPixel(x, y, color);
+            x = std::clamp(x + (int)(random() % 3) - 1, 0, size - 1);
+            y = std::clamp(y + (int)(random() % 3) - 1, 0, size - 1);
+        }
+        crosshair.commitBatch();
+        break;
+    }
+    case 4:
+    case 5:
+    case 6: {
+        int x = random() % size, y = random() % size;
+        crosshair.fillRect(PixelRect(x, y, x + 1 + random() % (size / 2), y + 1 + random() % (size / 2)), color);
+        break;
+    }
+    case 7:
+        crosshair.replaceColor(COLORS[random() % 3], color);
+        break;
+    case 8:
+        crosshair.multiplyAlpha((uint8_t)(128 + random() % 128));
+        break;
+    default:
+        if (random() % 4 == 0) {
+            crosshair.clear();
+        }
+        else {
+            crosshair.fillRect(PixelRect(0, 0, size, size), color);
+        }
+        break;
+    }
+}
+
+static bool check(const Crosshair& crosshair, const std::vector<uint64_t>& hashes, size_t position,
+    const char* what, int size) {
+    if (crosshair.getContentHash() == hashes[position]) return true;
+
+    printf("MISMATCH %dx%d: grid differs after %s to position %zu\n", size, size, what, position);
+    return false;
+}
+
+static bool run(int size) {
+    Crosshair crosshair;
+    crosshair.resize(size);
+    crosshair.initDefault();
+
+    EditHistory history;
+    history.reset(crosshair);
+    std::vector<uint64_t> hashes = { crosshair.getContentHash() };
+
+    std::mt19937 random(size);
+    Timings record;
+    for (int step = 0; step < ENTRIES; step++) {
+        // Every edit must change something, or it records no entry
+        uint64_t generation = crosshair.getGeneration();
+        do {
+            edit(crosshair, random, step);
+        } while (crosshair.getContentHash() == hashes.back());
+
+        auto start = std::chrono::steady_clock::now();
+        history.record(crosshair, crosshair.getDirtyRect(generation));
+        record.add(start);
+        hashes.push_back(crosshair.getContentHash());
+    }
+
+    if (history.getCount() != (size_t)ENTRIES) {
+        printf("FAIL %dx%d: %zu of %d entries kept in %zu bytes\n", size, size, history.getCount(), ENTRIES,
+            history.getMemoryUsage());
+        return false;
+    }
+
+    Timings undo;
+    for (size_t position = ENTRIES; position > 0; position--) {
+        auto start = std::chrono::steady_clock::now();
+        history.undo(crosshair);
+        undo.add(start);
+        if (!check(crosshair, hashes, position - 1, "undo", size)) return false;
+    }
+
+    Timings redo;
+    for (size_t position = 1; position <= ENTRIES; position++) {
+        auto start = std::chrono::steady_clock::now();
+        history.redo(crosshair);
+        redo.add(start);
+        if (!check(crosshair, hashes, position, "redo", size)) return false;
+    }
+
+    Timings jump;
+    for (int i = 0; i < JUMPS; i++) {
+        size_t position = random() % (ENTRIES + 1);
+        auto start = std::chrono::steady_clock::now();
+        history.jumpTo(position, crosshair);
+        jump.add(start);
+        if (!check(crosshair, hashes, position, "a jump", size)) return false;
+    }
+
+    printf("%4dx%-4d %8.1f %8.1f %8.1f %8.1f %8.1f %8.1f %8.1f %8.1f %9.0f\n", size, size,
+        record.percentile(50), record.percentile(100), undo.percentile(50), undo.percentile(100),
+        redo.percentile(50), redo.percentile(100), jump.percentile(50), jump.percentile(100),
+        history.getMemoryUsage() / 1024.0);
+
+    double slowest = std::max({ record.percentile(100), undo.percentile(100), redo.percentile(100), jump.percentile(100) });
+    if (size <= FRAME_CHECK_SIZE && slowest > FRAME_MICROS) {
+        printf("FAIL %dx%d: slowest step took %.0f us, longer than a frame\n", size, size, slowest);
+        return false;
+    }
+    return true;
+}
+
+int main() {
+    printf("%-9s %17s %17s %17s %17s %9s\n", "", "record (us)", "undo (us)", "redo (us)", "jump (us)", "");
+    printf("%-9s %8s %8s %8s %8s %8s %8s %8s %8s %9s\n", "grid", "median", "max", "median", "max",
+        "median", "max", "median", "max", "KB");
+
+    for (int size : GRID_SIZES) {
+        if (!run(size)) return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,217 @@
+// Checks every SIMD table in pixelKernels.cpp against the scalar reference,
+// then times each kernel per level. Built as its own console program (see
+// Pixel Kernels Test.vcxproj), never as part of the overlay.
+//
+// Every kernel runs at start offsets 0-7 pixels past an aligned buffer and
+// with 0-15 pixels cut off the end, so each vector loop is entered unaligned
+// and leaves every possible tail, over 64x64, 256x256 and 1024x1024 grids.
+// Exits with 1 on the first mismatch.
+#include "../src/common/pixelKernels.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+static constexpr int GRID_SIZES[] = { 64, 256, 1024 };
+static constexpr int MAX_OFFSET = 8;
+static constexpr int MAX_TAIL = 16;
+
+static const char* getLevelName(PixelKernelLevel level) {
+    switch (level) {
+    case PixelKernelLevel::SSE2: return "SSE2";
+    case PixelKernelLevel::AVX2: return "AVX2";
+    default: return "Scalar";
+    }
+}
+
+// Pixels with a few repeated colors, about a quarter of them fully
+// transparent with leftover color bits, so replaceColor and the alpha
+// kernels have something to find
+static std::vector<uint32_t> makePixels(size_t count, uint32_t seed) {
+    static constexpr uint32_t PALETTE[] = { 0xFF0000FF, 0x80FFFFFF, 0x00123456, 0x01000000 };
+
+    std::mt19937 random(seed);
+    std::vector<uint32_t> pixels(count);
+    for (uint32_t& pixel : pixels) {
+        uint32_t value = random();
+        switch (value & 7) {
+        case 0:
+        case 1: pixel = PALETTE[(value >> 3) & 3]; break;
+        case 2:
+        case 3: pixel = value & 0x00FFFFFF; break;
+        default: pixel = value; break;
+        }
+    }
+    return pixels;
+}
+
+static bool report(const char* kernel, PixelKernelLevel level, int gridSize, int offset, int count) {
+    printf("MISMATCH %s %s grid %d offset %d count %d\n", kernel, getLevelName(level), gridSize, offset, count);
+    return false;
+}
+
+// Run every kernel of one table and the scalar table on the same span
+static bool compareSpan(const PixelKernels& test, const std::vector<uint32_t>& source,
+    int gridSize, int offset, int count) {
+    const PixelKernels& scalar = PixelKernels::get(PixelKernelLevel::Scalar);
+    PixelKernelLevel level = test.level;
+
+    std::vector<uint32_t> expected(source);
+    std::vector<uint32_t> actual(source);
+    uint32_t* want = expected.data() + offset;
+    uint32_t* got = actual.data() + offset;
+
+    // Fill a color that some pixels already hold
+    uint32_t color = source[offset + count / 2];
+    if (scalar.fillRow(want, count, color) != test.fillRow(got, count, color) || expected != actual) {
+        return report("fillRow", level, gridSize, offset, count);
+    }
+
+    expected = source;
+    actual = source;
+    scalar.copyRow(want, source.data() + MAX_OFFSET - 1 - offset, count);
+    test.copyRow(got, source.data() + MAX_OFFSET - 1 - offset, count);
+    if (expected != actual) {
+        return report("copyRow", level, gridSize, offset, count);
+    }
+
+    // Guard words catch writes past (count + 63) / 64
+    size_t words = (size_t)(count + 63) / 64;
+    std::vector<uint64_t> wantBits(words + 1, ~0ull);
+    std::vector<uint64_t> gotBits(words + 1, ~0ull);
+    if (scalar.scanAlpha(source.data() + offset, count, wantBits.data())
+        != test.scanAlpha(source.data() + offset, count, gotBits.data()) || wantBits != gotBits) {
+        return report("scanAlpha", level, gridSize, offset, count);
+    }
+
+    expected = source;
+    actual = source;
+    scalar.clearTransparent(want, count);
+    test.clearTransparent(got, count);
+    if (expected != actual) {
+        return report("clearTransparent", level, gridSize, offset, count);
+    }
+
+    expected = source;
+    actual = source;
+    if (scalar.replaceColor(want, count, 0xFF0000FF, 0x12345678)
+        != test.replaceColor(got, count, 0xFF0000FF, 0x12345678) || expected != actual) {
+        return report("replaceColor", level, gridSize, offset, count);
+    }
+
+    for (int factor : { 0, 1, 127, 254, 255 }) {
+        expected = source;
+        actual = source;
+        scalar.multiplyAlpha(want, count, (uint8_t)factor);
+        test.multiplyAlpha(got, count, (uint8_t)factor);
+        if (expected != actual) {
+            return report("multiplyAlpha", level, gridSize, offset, count);
+        }
+    }
+
+    return true;
+}
+
+static bool compareLevel(PixelKernelLevel level) {
+    const PixelKernels& test = PixelKernels::get(level);
+
+    for (int gridSize : GRID_SIZES) {
+        int pixels = gridSize * gridSize;
+        std::vector<uint32_t> source = makePixels((size_t)pixels + MAX_OFFSET, (uint32_t)gridSize);
+
+        // One row at every offset and tail, then the whole grid as one span
+        for (int offset = 0; offset < MAX_OFFSET; offset++) {
+            for (int tail = 0; tail < MAX_TAIL; tail++) {
+                if (!compareSpan(test, source, gridSize, offset, gridSize - tail)) return false;
+            }
+            if (!compareSpan(test, source, gridSize, offset, pixels - offset)) return false;
+        }
+
+        // Short spans that never reach the vector loop
+        for (int count = 0; count < MAX_TAIL * 2; count++) {
+            if (!compareSpan(test, source, gridSize, 1, count)) return false;
+        }
+    }
+
+    printf("%s matches scalar\n", getLevelName(level));
+    return true;
+}
+
+// Nanoseconds per call of work over a whole grid, best of several rounds
+template <typename Work>
+static double timeKernel(int pixels, Work work) {
+    int calls = std::max(1, (1 << 22) / pixels);
+    double best = 1e30;
+    for (int round = 0; round < 5; round++) {
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < calls; i++) {
+            work();
+        }
+        std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+        best = std::min(best, elapsed.count() / calls);
+    }
+    return best;
+}
+
+static void benchmark(const std::vector<PixelKernelLevel>& levels) {
+    printf("\n%-17s %6s", "ns per grid", "grid");
+    for (PixelKernelLevel level : levels) {
+        printf(" %10s", getLevelName(level));
+    }
+    printf("\n");
+
+    static const char* KERNEL_NAMES[] = { "fillRow", "copyRow", "scanAlpha", "clearTransparent", "replaceColor", "multiplyAlpha" };
+
+    for (int kernel = 0; kernel < 6; kernel++) {
+        for (int gridSize : GRID_SIZES) {
+            int pixels = gridSize * gridSize;
+            std::vector<uint32_t> source = makePixels((size_t)pixels + 1, 1);
+            std::vector<uint32_t> pixelsCopy(source);
+            std::vector<uint64_t> bits((size_t)(pixels + 63) / 64);
+
+            // Every call goes through the table into another translation
+            // unit, so none of them can be optimized away
+            uint32_t color = 0;
+
+            printf("%-17s %4dx%-4d", KERNEL_NAMES[kernel], gridSize, gridSize);
+            for (PixelKernelLevel level : levels) {
+                const PixelKernels& k = PixelKernels::get(level);
+
+                // Start one pixel in, as rows of a grid usually do not fall on a vector boundary
+                uint32_t* dst = pixelsCopy.data() + 1;
+                const uint32_t* src = source.data() + 1;
+                double ns = 0;
+                switch (kernel) {
+                case 0: ns = timeKernel(pixels, [&]() { k.fillRow(dst, pixels, color++); }); break;
+                case 1: ns = timeKernel(pixels, [&]() { k.copyRow(dst, src, pixels); }); break;
+                case 2: ns = timeKernel(pixels, [&]() { k.scanAlpha(src, pixels, bits.data()); }); break;
+                case 3: ns = timeKernel(pixels, [&]() { k.clearTransparent(dst, pixels); }); break;
+                case 4: ns = timeKernel(pixels, [&]() { k.replaceColor(dst, pixels, 0xFF0000FF, 0xFF0000FF); }); break;
+                case 5: ns = timeKernel(pixels, [&]() { k.multiplyAlpha(dst, pixels, 255); }); break;
+                }
+                printf(" %10.0f", ns);
+            }
+            printf("\n");
+        }
+    }
+}
+
+int main() {
+    std::vector<PixelKernelLevel> levels = { PixelKernelLevel::Scalar };
+    for (PixelKernelLevel level : { PixelKernelLevel::SSE2, PixelKernelLevel::AVX2 }) {
+        if (PixelKernels::isSupported(level)) {
+            levels.push_back(level);
+        }
+        else {
+            printf("%s not supported here, skipped\n", getLevelName(level));
+        }
+    }
+
+    for (size_t i = 1; i < levels.size(); i++) {
+        if (!compareLevel(levels[i])) return 1;
+    }
+
+    benchmark(levels);
+    return 0;
+}
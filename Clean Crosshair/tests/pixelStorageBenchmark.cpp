@@ -0,0 +1,94 @@
+// Compares PixelStorage with the flat pixel vector it replaced: bytes held,
+// and the time of one pass over every run of opaque pixels in the grid (what
+// bounds, coverage, the mesh builder and the serializer all start from).
+// Built as its own console program (see Pixel Storage Benchmark.vcxproj).
+#include "common/pixelStorage.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <vector>
+
+// A plus with arms a quarter of the grid long, in one or several colors,
+// optionally with a 24x24 gradient block in a corner
+static std::vector<uint32_t> makeCrosshair(int size, int colors, bool gradient) {
+    static constexpr uint32_t COLORS[] = { 0xFFFFFFFF, 0xFF0000FF, 0xFF00FF00, 0xFFFF0000 };
+
+    std::vector<uint32_t> pixels((size_t)size * size, 0);
+    int center = size / 2;
+    int arm = size / 4;
+    for (int i = -arm; i < arm; i++) {
+        uint32_t color = COLORS[(i + arm) * colors / (2 * arm)];
+        for (int t = -1; t <= 1; t++) {
+            pixels[(size_t)(center + t) * size + center + i] = color;
+            pixels[(size_t)(center + i) * size + center + t] = color;
+        }
+    }
+
+    if (gradient) {
+        for (int y = 0; y < 24; y++) {
+            for (int x = 0; x < 24; x++) {
+                pixels[(size_t)(y + 4) * size + x + 4] = 0xFF000000 | (x * 10) | (y * 10 << 8);
+            }
+        }
+    }
+    return pixels;
+}
+
+// Best time of several rounds of work, in microseconds
+template <typename Work>
+static double timeMicros(Work work) {
+    double best = 1e30;
+    for (int round = 0; round < 20; round++) {
+        auto start = std::chrono::steady_clock::now();
+        work();
+        best = std::min(best, std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count());
+    }
+    return best;
+}
+
+static void run(const char* name, int size, int colors, bool gradient) {
+    std::vector<uint32_t> flat = makeCrosshair(size, colors, gradient);
+    PixelStorage storage;
+    storage.assign(size, flat);
+
+    // Both passes sum the span lengths so neither can be skipped
+    long long flatCovered = 0;
+    double flatMicros = timeMicros([&]() {
+        flatCovered = 0;
+        for (int y = 0; y < size; y++) {
+            const uint32_t* row = &flat[(size_t)y * size];
+            int x = 0;
+            while (x < size) {
+                while (x < size && packedAlpha(row[x]) == 0) x++;
+                int start = x;
+                while (x < size && packedAlpha(row[x]) != 0) x++;
+                flatCovered += x - start;
+            }
+        }
+    });
+
+    long long storageCovered = 0;
+    double storageMicros = timeMicros([&]() {
+        storageCovered = 0;
+        for (int y = 0; y < size; y++) {
+            storage.forEachSpan(y, [&](int startX, int endX) { storageCovered += endX - startX; });
+        }
+    });
+
+    static const char* FORMAT_NAMES[] = { "Mask", "Palette", "RGBA", "Tiled" };
+    printf("%-26s %-8s %10.1f %10.1f %10.2f %10.2f%s\n", name, FORMAT_NAMES[(int)storage.getFormat()],
+        storage.getMemoryUsage() / 1024.0, flat.size() * sizeof(uint32_t) / 1024.0,
+        storageMicros, flatMicros, storageCovered == flatCovered ? "" : "  MISMATCH");
+}
+
+int main() {
+    printf("%-26s %-8s %10s %10s %10s %10s\n", "", "format", "KB", "flat KB", "spans us", "flat us");
+    run("64x64, 1 color", 64, 1, false);
+    run("64x64, 4 colors", 64, 4, false);
+    run("256x256, 1 color", 256, 1, false);
+    run("256x256, 4 colors", 256, 4, false);
+    run("1024x1024, 1 color", 1024, 1, false);
+    run("1024x1024, 4 colors", 1024, 4, false);
+    run("1024x1024, 4 colors+block", 1024, 4, true);
+    return 0;
+}
@@ -0,0 +1,319 @@
+// Randomized test of PixelStorage against a flat reference model: a plain
+// vector of size * size pixels that every operation is also applied to. Runs
+// random writes, fills, clears, row writes, color replacements, fades,
+// resizes and whole-grid assigns, with few or many colors so every format and
+// every widening between them is reached, and compares the two after each
+// step. Built as its own console program (see Pixel Storage Test.vcxproj).
+// Exits with 1 on the first difference, printing the seed to replay it.
+#include "common/pixelStorage.h"
+#include "common/pixelKernels.h"
+#include <cstdio>
+#include <random>
+#include <vector>
+
+static constexpr int GRID_SIZES[] = { 1, 15, 64, 65, 128, 129, 200, 256 };
+static constexpr int SEEDS_PER_SIZE = 6;
+static constexpr int STEPS = 1500;
+
+struct Model {
+    int size = 0;
+    std::vector<uint32_t> pixels;
+
+    uint32_t& at(int x, int y) { return pixels[(size_t)y * size + x]; }
+};
+
+// Transparent pixels are stored as 0 whatever their color bits
+static uint32_t normalize(uint32_t color) {
+    return packedAlpha(color) != 0 ? color : 0;
+}
+
+class Fuzzer {
+public:
+    Fuzzer(int size, uint32_t seed)
+        : m_random(seed),
+        m_seed(seed),
+        m_step(0) {
+        m_storage.reset(size);
+        m_model.size = size;
+        m_model.pixels.assign((size_t)size * size, 0);
+
+        // Seeds cycle through one color, a handful, and more than a palette holds
+        static constexpr int COLOR_COUNTS[] = { 1, 4, 400 };
+        int colorCount = COLOR_COUNTS[seed % 3];
+        for (int i = 0; i < colorCount; i++) {
+            m_colors.push_back((m_random() & 0x00FFFFFF) | ((1 + m_random() % 255) << 24));
+        }
+    }
+
+    bool run() {
+        for (m_step = 0; m_step < STEPS; m_step++) {
+            step();
+            m_formatsSeen[(int)m_storage.getFormat()] = true;
+
+            // Small grids are compared every step, large ones now and then
+            bool full = m_model.size <= 64 || m_step % 25 == 0 || m_step == STEPS - 1;
+            if (!compare(full)) return false;
+        }
+        return true;
+    }
+
+    bool sawFormat(PixelFormat format) const { return m_formatsSeen[(int)format]; }
+
+private:
+    std::mt19937 m_random;
+    uint32_t m_seed;
+    int m_step;
+    PixelStorage m_storage;
+    Model m_model;
+    std::vector<uint32_t> m_colors;
+    bool m_formatsSeen[4] = {};
+
+    int pick(int count) { return count > 0 ? (int)(m_random() % (uint32_t)count) : 0; }
+
+    // Mostly opaque colors from the set, sometimes transparent with stray
+    // color bits
+    uint32_t randomColor() {
+        if (m_random() % 8 == 0) {
+            return m_random() & 0x00FFFFFF;
+        }
+        return m_colors[pick((int)m_colors.size())];
+    }
+
+    // May reach past the grid on any side; storage and model both clip
+    PixelRect randomRect() {
+        int size = m_model.size;
+        int x = pick(size + 8) - 4;
+        int y = pick(size + 8) - 4;
+        return PixelRect(x, y, x + 1 + pick(size / 2 + 2), y + 1 + pick(size / 2 + 2));
+    }
+
+    void modelFill(PixelRect rect, uint32_t color) {
+        for (int y = std::max(rect.minY, 0); y < std::min(rect.maxY, m_model.size); y++) {
+            for (int x = std::max(rect.minX, 0); x < std::min(rect.maxX, m_model.size); x++) {
+                m_model.at(x, y) = color;
+            }
+        }
+    }
+
+    void step() {
+        int size = m_model.size;
+
+        switch (m_random() % 16) {
+        case 0: case 1: case 2: case 3: case 4: {
+            // Strokes of single pixels
+            uint32_t color = randomColor();
+            for (int i = 0; i < 1 + pick(20); i++) {
+                int x = pick(size), y = pick(size);
+                m_storage.set(x, y, normalize(color));
+                m_model.at(x, y) = normalize(color);
+            }
+            break;
+        }
+        case 5: case 6: {
+            PixelRect rect = randomRect();
+            uint32_t color = randomColor();
+            m_storage.fillRect(rect, color);
+            modelFill(rect, normalize(color));
+            break;
+        }
+        case 7: {
+            PixelRect rect = randomRect();
+            m_storage.clearRect(rect);
+            modelFill(rect, 0);
+
+            // Clearing the last pixels goes back to the smallest format
+            PixelRect clipped(std::max(rect.minX, 0), std::max(rect.minY, 0),
+                std::min(rect.maxX, size), std::min(rect.maxY, size));
+            if (!clipped.isEmpty() && m_storage.getCoveredCount() == 0 && m_storage.getFormat() != PixelFormat::Mask) {
+                printf("Format %d left after clearing everything\n", (int)m_storage.getFormat());
+                m_model.pixels.assign(m_model.pixels.size(), 0xDEADBEEF);  // Force a mismatch
+            }
+            break;
+        }
+        case 8: case 9: {
+            int y = pick(size);
+            int x = pick(size);
+            int count = 1 + pick(size - x);
+            std::vector<uint32_t> row(count);
+            for (uint32_t& pixel : row) {
+                pixel = randomColor();
+            }
+            m_storage.writeRow(y, x, count, row.data());
+            for (int i = 0; i < count; i++) {
+                m_model.at(x + i, y) = normalize(row[i]);
+            }
+            break;
+        }
+        case 10: {
+            // Usually a color that is present, so something is replaced
+            uint32_t from = m_model.pixels[pick((int)m_model.pixels.size())];
+            if (from == 0) from = randomColor();
+            uint32_t to = randomColor();
+
+            int expected = 0;
+            if (packedAlpha(from) != 0 && from != to) {
+                for (uint32_t& pixel : m_model.pixels) {
+                    if (pixel == from) {
+                        pixel = normalize(to);
+                        expected++;
+                    }
+                }
+            }
+            int replaced = m_storage.replaceColor(from, to);
+            if (replaced != expected) {
+                printf("replaceColor returned %d, expected %d\n", replaced, expected);
+                m_model.pixels.assign(m_model.pixels.size(), 0xDEADBEEF);  // Force a mismatch
+            }
+            break;
+        }
+        case 11: {
+            static constexpr uint8_t FACTORS[] = { 0, 1, 2, 64, 128, 200, 254, 255 };
+            uint8_t factor = FACTORS[pick(8)];
+            m_storage.multiplyAlpha(factor);
+            for (uint32_t& pixel : m_model.pixels) {
+                uint8_t alpha = scaleAlpha(packedAlpha(pixel), factor);
+                pixel = alpha != 0 ? (pixel & 0x00FFFFFF) | ((uint32_t)alpha << 24) : 0;
+            }
+            break;
+        }
+        case 12: {
+            // Grow or shrink around the starting size, keeping the top left
+            int newSize = std::max(1, size + pick(33) - 16);
+            m_storage.resize(newSize);
+            Model resized;
+            resized.size = newSize;
+            resized.pixels.assign((size_t)newSize * newSize, 0);
+            for (int y = 0; y < std::min(size, newSize); y++) {
+                for (int x = 0; x < std::min(size, newSize); x++) {
+                    resized.at(x, y) = m_model.at(x, y);
+                }
+            }
+            m_model = std::move(resized);
+            break;
+        }
+        case 13: {
+            // Whole grid replaced, mostly empty like a real preset
+            std::vector<uint32_t> pixels((size_t)size * size, 0);
+            for (uint32_t& pixel : pixels) {
+                if (m_random() % 4 == 0) pixel = randomColor();
+            }
+            m_storage.assign(size, pixels);
+            for (size_t i = 0; i < pixels.size(); i++) {
+                m_model.pixels[i] = normalize(pixels[i]);
+            }
+            break;
+        }
+        case 14: {
+            if (m_random() % 4 == 0) {
+                m_storage.clearRect(PixelRect(0, 0, size, size));
+                modelFill(PixelRect(0, 0, size, size), 0);
+            }
+            break;
+        }
+        default:
+            break;
+        }
+    }
+
+    bool fail(const char* what, int x, int y, uint32_t got, uint32_t expected) {
+        printf("MISMATCH %s at (%d, %d): 0x%08X, expected 0x%08X (size %d, seed %u, step %d, format %d)\n",
+            what, x, y, got, expected, m_model.size, m_seed, m_step, (int)m_storage.getFormat());
+        return false;
+    }
+
+    bool compare(bool full) {
+        int size = m_model.size;
+        if (m_storage.getSize() != size) {
+            return fail("size", 0, 0, m_storage.getSize(), size);
+        }
+
+        int covered = 0;
+        for (uint32_t pixel : m_model.pixels) {
+            covered += pixel != 0;
+        }
+        if (m_storage.getCoveredCount() != covered) {
+            return fail("covered count", 0, 0, m_storage.getCoveredCount(), covered);
+        }
+        if (!full) return true;
+
+        std::vector<uint32_t> scratch(size);
+        for (int y = 0; y < size; y++) {
+            for (int x = 0; x < size; x++) {
+                uint32_t expected = m_model.at(x, y);
+                if (m_storage.get(x, y) != expected) {
+                    return fail("get", x, y, m_storage.get(x, y), expected);
+                }
+                if (m_storage.isCovered(x, y) != (expected != 0)) {
+                    return fail("coverage bit", x, y, m_storage.isCovered(x, y), expected != 0);
+                }
+            }
+
+            // A row segment through both row readers
+            int x = pick(size);
+            int count = 1 + pick(size - x);
+            std::span<const uint32_t> view = m_storage.getRow(y, x, count, scratch.data());
+            std::vector<uint32_t> read(count);
+            m_storage.readRow(y, x, count, read.data());
+            for (int i = 0; i < count; i++) {
+                if (view[i] != m_model.at(x + i, y)) return fail("getRow", x + i, y, view[i], m_model.at(x + i, y));
+                if (read[i] != m_model.at(x + i, y)) return fail("readRow", x + i, y, read[i], m_model.at(x + i, y));
+            }
+
+            // Spans must be exactly the runs of non-transparent pixels
+            int next = 0;
+            bool spansOk = true;
+            m_storage.forEachSpan(y, [&](int startX, int endX) {
+                for (int i = next; i < startX; i++) spansOk &= m_model.at(i, y) == 0;
+                for (int i = startX; i < endX; i++) spansOk &= m_model.at(i, y) != 0;
+                spansOk &= startX < endX && (endX == size || m_model.at(endX, y) == 0);
+                next = endX;
+            });
+            for (int i = next; i < size; i++) spansOk &= m_model.at(i, y) == 0;
+            if (!spansOk) return fail("forEachSpan", 0, y, 0, 0);
+        }
+
+        // Every covered pixel lies inside a visited region
+        std::vector<uint8_t> inRegion((size_t)size * size, 0);
+        m_storage.forEachRegion([&](const PixelRect& region) {
+            for (int y = region.minY; y < region.maxY; y++) {
+                for (int x = region.minX; x < region.maxX; x++) {
+                    inRegion[(size_t)y * size + x] = 1;
+                }
+            }
+        });
+        for (int y = 0; y < size; y++) {
+            for (int x = 0; x < size; x++) {
+                if (m_model.at(x, y) != 0 && !inRegion[(size_t)y * size + x]) {
+                    return fail("forEachRegion", x, y, 0, m_model.at(x, y));
+                }
+            }
+        }
+        return true;
+    }
+};
+
+int main() {
+    static const char* FORMAT_NAMES[] = { "Mask", "Palette", "RGBA", "Tiled" };
+    bool seen[4] = {};
+    int runs = 0;
+
+    for (int size : GRID_SIZES) {
+        for (uint32_t seed = 1; seed <= SEEDS_PER_SIZE; seed++) {
+            Fuzzer fuzzer(size, seed * 7919 + size);
+            if (!fuzzer.run()) return 1;
+            for (int format = 0; format < 4; format++) {
+                seen[format] |= fuzzer.sawFormat((PixelFormat)format);
+            }
+            runs++;
+        }
+    }
+
+    printf("%d runs of %d steps match the flat model; formats reached:", runs, STEPS);
+    bool allSeen = true;
+    for (int format = 0; format < 4; format++) {
+        printf(" %s%s", FORMAT_NAMES[format], seen[format] ? "" : " (missed)");
+        allSeen &= seen[format];
+    }
+    printf("\n");
+    return allSeen ? 0 : 1;
+}
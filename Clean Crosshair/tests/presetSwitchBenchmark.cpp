@@ -0,0 +1,122 @@
+// Times the two ways the editor switches to a preset without the disk:
+// swapping in a grid from PreparedPresets, and copying decoded pixels from
+// the PixelCache in with assignPixels. Also reports what building a prepared
+// grid costs off the UI thread and how much memory each form takes. Built as
+// its own console program (see Preset Switch Benchmark.vcxproj). Exits with 1
+// if a switch leaves the wrong pixels in place.
+#include "common/crosshair.h"
+#include "common/pixelCache.h"
+#include "editor/preparedPresets.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+static constexpr int GRID_SIZES[] = { 64, 256, 1024 };
+static constexpr int PRESET_COUNT = 8;
+static constexpr int SWITCHES = 200;
+
+// A plus of a few colors, like most presets, or noise in every pixel
+static std::vector<uint32_t> makePreset(int size, int variant, bool noisy) {
+    std::vector<uint32_t> pixels((size_t)size * size, 0);
+    std::mt19937 random(variant);
+    int center = size / 2;
+    int arm = size / 4;
+    for (int y = 0; y < size; y++) {
+        for (int x = 0; x < size; x++) {
+            bool onPlus = (std::abs(x - center) <= 1 + variant % 3 && std::abs(y - center) < arm)
+                || (std::abs(y - center) <= 1 + variant % 3 && std::abs(x - center) < arm);
+            if (noisy) {
+                pixels[(size_t)y * size + x] = random() | 0xFF000000;
+            }
+            else if (onPlus) {
+                pixels[(size_t)y * size + x] = 0xFF000000 | (0x30 * (variant + 1));
+            }
+        }
+    }
+    return pixels;
+}
+
+static double microsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+}
+
+static bool run(int size, bool noisy) {
+    PixelCache cache(1024ull * 1024 * 1024);
+    PreparedPresets prepared(1024ull * 1024 * 1024);
+    std::vector<uint64_t> hashes;
+
+    // Build every preset both ways, as the warm-up does
+    double buildMicros = 0;
+    for (int i = 0; i < PRESET_COUNT; i++) {
+        std::vector<uint32_t> pixels = makePreset(size, i, noisy);
+        auto start = std::chrono::steady_clock::now();
+        auto crosshair = std::make_shared<Crosshair>();
+        crosshair->assignPixels(size, pixels);
+        uint64_t hash = crosshair->getContentHash();
+        buildMicros += microsSince(start);
+
+        hashes.push_back(hash);
+        prepared.keep(hash, std::move(crosshair));
+        cache.insert(hash, size, std::move(pixels));
+    }
+
+    // The editor's grid starts out holding the first preset, taken out of the set
+    Crosshair editor;
+    editor.swapPixels(*prepared.take(hashes[0]));
+    uint64_t current = hashes[0];
+
+    // Swap: take the new grid, swap it in, keep the old one for switching back
+    std::vector<double> swapMicros;
+    for (int i = 1; i <= SWITCHES; i++) {
+        uint64_t hash = hashes[i % PRESET_COUNT];
+        auto start = std::chrono::steady_clock::now();
+        std::shared_ptr<Crosshair> grid = prepared.take(hash);
+        editor.swapPixels(*grid);
+        prepared.keep(current, std::move(grid));
+        swapMicros.push_back(microsSince(start));
+        current = hash;
+
+        if (editor.getContentHash() != hash) {
+            printf("MISMATCH swap %dx%d switch %d\n", size, size, i);
+            return false;
+        }
+    }
+
+    // Cache hit: find the decoded pixels and copy them in
+    std::vector<double> copyMicros;
+    for (int i = 1; i <= SWITCHES; i++) {
+        uint64_t hash = hashes[i % PRESET_COUNT];
+        auto start = std::chrono::steady_clock::now();
+        std::shared_ptr<const PixelCache::Pixels> pixels = cache.find(hash);
+        editor.assignPixels(pixels->size, pixels->data);
+        copyMicros.push_back(microsSince(start));
+
+        if (editor.getContentHash() != hash) {
+            printf("MISMATCH copy %dx%d switch %d\n", size, size, i);
+            return false;
+        }
+    }
+
+    std::sort(swapMicros.begin(), swapMicros.end());
+    std::sort(copyMicros.begin(), copyMicros.end());
+    printf("%4dx%-4d %-5s %9.1f %9.1f %9.1f %9.1f %10.1f %9.1f %9.1f\n", size, size, noisy ? "noise" : "plus",
+        swapMicros[SWITCHES / 2], swapMicros[SWITCHES * 99 / 100],
+        copyMicros[SWITCHES / 2], copyMicros[SWITCHES * 99 / 100],
+        buildMicros / PRESET_COUNT,
+        prepared.getBytes() / 1024.0 / (PRESET_COUNT - 1), cache.getBytes() / 1024.0 / PRESET_COUNT);
+    return true;
+}
+
+int main() {
+    printf("%-15s %19s %19s %10s %19s\n", "", "swap (us)", "cache hit (us)", "build (us)", "KB per preset");
+    printf("%-15s %9s %9s %9s %9s %10s %9s %9s\n", "grid", "median", "p99", "median", "p99", "mean", "prepared", "cached");
+
+    for (int size : GRID_SIZES) {
+        for (bool noisy : { false, true }) {
+            if (!run(size, noisy)) return 1;
+        }
+    }
+    return 0;
+}